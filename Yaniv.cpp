@@ -7,24 +7,136 @@
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <limits>
 #include <ctime>
+#include <chrono>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <mutex>
+#include <functional>
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <tuple>
+#include <cstring>
+#include <cstddef>
+#include <cassert>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#if !defined(_WIN32) && !defined(WIN32)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 using namespace std;
 
+#ifdef COUNT_ALLOCATIONS
+// heap allocations made by this thread, so --self-test can check that AI turns don't allocate (only in builds made with -DCOUNT_ALLOCATIONS)
+thread_local long long allocations = 0;
+const bool COUNTING_ALLOCATIONS = true;
+
+void* operator new(size_t size) {
+	++allocations;
+	void *memory = malloc(size ? size : 1);
+	if (!memory) { throw bad_alloc(); }
+	return memory;
+}
+
+// gcc takes memory from the replaced operator new being freed with free() for a mismatch once these are inlined
+#if defined(__GNUC__) && __GNUC__ >= 11 && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void *memory) noexcept {
+	free(memory);
+}
+#if defined(__GNUC__) && __GNUC__ >= 11 && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+void operator delete(void *memory, size_t) noexcept {
+	operator delete(memory);
+}
+#else
+const long long allocations = 0;
+const bool COUNTING_ALLOCATIONS = false;
+#endif
+
 #define MIN_PLAYERS 2 // minimum number of players
 #define MAX_PLAYERS 8 // maximum number of players
+#define MAX_TURNS_PER_ROUND 1000 // rounds longer than this are stuck (ex. AIs trading the same face-up cards) and are redealt
+#define ASSAF_SAMPLES 256 // hands of the other players an AI imagines before calling Yaniv
+#define ASSAF_BATCH 128 // samples whose points are added up together
+#define ENDGAME_SAMPLES 128 // hands the endgame look-ahead imagines each turn (a multiple of ASSAF_BATCH), an AI playing with 256 didn't win more often
+#define ASSAF_RISK_LIMIT 0.15 // AIs call Yaniv if the chance of being Assaf-ed is at most this
+#define FACE_UP_TAKES_LIMIT 8 // AIs draw from the draw pile once this many turns in a row took a face-up card, so rounds no one can call don't go in circles
+#define ENDGAME_CARDS 3 // AIs holding this many cards or fewer play by the endgame look-ahead
+// the endgame look-ahead takes the chance of being Assaf-ed as this much higher than assafRisk samples it: samples deal the unseen cards
+// evenly, but players keep their low cards and throw the high ones, so the real chance is higher (tuned by playing one AI with
+// other weights against AIs using 1.5: 1.0, 2.0 and 3.0 all won less)
+#define ENDGAME_RISK_WEIGHT 1.5f
+#define DISCARD_TABLE_FILE "yaniv-discards.bin" // best discards worked out ahead of time with --gen-table, used if the file is there
+#define DISCARD_TABLE_CARDS 5 // largest hand in the discard table
+#define DISCARD_TABLE_VERSION 1 // files written by another version are ignored (bump when getBestDiscard changes)
+#define RECORD_VERSION 4 // game record files written by another version aren't appended to or read (bump when an event changes)
+#define RECORD_SNAPSHOT_TURNS 100 // recorded games hold the whole game state every this many turns so replays can start there
+#define RECORD_BUFFER_BYTES (1 << 20) // recorded games a worker thread holds before writing them to its file as one block
+#define RECORD_HAND_SIZES 16 // Yaniv calls are counted by the cards in the caller's hand up to this many (bigger hands count as the last)
+#define DEFAULT_PLAYOUTS 1000 // rollouts a search AI plays before each decision
+#define PLAYOUT_TURNS 200 // rollouts longer than this are scored from the hands held
+#define EXPLORATION 0.1 // how much a search AI tries moves that haven't done well yet
+#define MIN_SEARCH_BUDGET 1 // ms, search AIs given less time than this play the heuristic's move without searching
+#define INTERACTIVE_BUDGET 20 // ms a search AI may think per move in games with humans watching
+#define SEARCH_CANDIDATES 8 // most moves a search AI tries besides calling Yaniv
+#define SEARCH_MARGIN 0.01 // average reward a searched move needs over the heuristic AI's move to be played instead
+#define REWARD_SCALE 1000000 // rollout rewards are kept as whole numbers so threads can add them without locks
+#define BENCH_SEED 20190114 // benchmarks always run on the same generated hands so runs can be compared
+#define BENCH_STATES 4096 // generated hands each benchmark cycles through
+#define BENCH_GAMES 200 // games played for the whole-game benchmark
+#define BENCH_SEARCHES 20 // first moves of games a search AI decides for the search benchmark
+#define SELF_TEST_SEED 20190114 // --self-test plays the same games every run so a failure can be looked into
+#define SELF_TEST_GAMES 200 // games --self-test plays checking every AI turn
+#define SELF_TEST_RECORD_GAMES 20 // games --self-test records and reads back to check the record format
+#define SELF_TEST_RECORD_FILE "yaniv-self-test.rec" // where they are recorded, removed afterwards
+#define SELF_TEST_REPLAY_GAMES 4 // games --self-test records and replays to every turn
+#define SELF_TEST_UNDO_GAMES 20 // games --self-test plays with makeMove, taking back every round's moves and making them again
+
+// rules a game is played with, each game has its own so games with different variations can run side by side
+struct Rules {
+	/* NUMBERS */
+	int cardsAtStart = 5; // cards each player is dealt
+	int minToCallYaniv = 7; // minimum points to call Yaniv
+	int assafPenalty = 30; // penalty for being Assaf-ed
+	int extraAssafPenalties = 0; // additional penalties for each additional player who can Assaf you (usually 20 pts when applied)
+	int pointsLimit = 200; // Score that eliminates players
+
+	/* RULE VARIATIONS */
+	bool canSlapdown = true; // if you draw from the draw pile the same type of card you just played, you can slap down your drawn card
+	bool canSwapJoker = true; // if next player has the card that goes in place of the joker, they can swap for it
+	bool canTakeFromMiddleOfSet = true; // if 3-of-a-kind or 4-of-a-kind played, the next player may take any card from the set
+	bool reductionIsHalf = true; // 50% reduction as opposed a 50-point reduction
+};
 
-/* NUMBERS */
-int CARDS_AT_START = 5; // cards each player is dealt
-int MIN_TO_CALL_YANIV = 7; // minimum points to call Yaniv
-int ASSAF_PENALTY = 30; // penalty for being Assaf-ed
-int EXTRA_ASSAF_PENALTIES = 0; // additional penalties for each additional player who can Assaf you (usually 20 pts when applied)
-int POINTS_LIMIT = 200; // Score that eliminates players
+// rule variations looked up in the game's rules every time they are checked
+struct RuntimeRules {
+	static bool canSlapdown(const Rules &rules) { return rules.canSlapdown; }
+	static bool canSwapJoker(const Rules &rules) { return rules.canSwapJoker; }
+	static bool canTakeFromMiddleOfSet(const Rules &rules) { return rules.canTakeFromMiddleOfSet; }
+	static bool reductionIsHalf(const Rules &rules) { return rules.reductionIsHalf; }
+};
 
-/* RULE VARIATIONS */
-bool CAN_SLAPDOWN = true; // if you draw from the draw pile the same type of card you just played, you can slap down your drawn card
-bool CAN_SWAP_JOKER = true; // if next player has the card that goes in place of the joker, they can swap for it
-bool CAN_TAKE_FROM_MIDDLE_OF_SET = true; // if 3-of-a-kind or 4-of-a-kind played, the next player may take any card from the set
-bool REDUCTION_IS_HALF = true; // 50% reduction as opposed a 50-point reduction
+// rule variations fixed when compiled so the branches for the other variations are removed
+template <bool SLAPDOWN, bool SWAP_JOKER, bool TAKE_FROM_MIDDLE_OF_SET, bool REDUCTION_IS_HALF>
+struct FixedRules {
+	static bool canSlapdown(const Rules&) { return SLAPDOWN; }
+	static bool canSwapJoker(const Rules&) { return SWAP_JOKER; }
+	static bool canTakeFromMiddleOfSet(const Rules&) { return TAKE_FROM_MIDDLE_OF_SET; }
+	static bool reductionIsHalf(const Rules&) { return REDUCTION_IS_HALF; }
+};
 
 // Clear screen with "CLS" on Windows or with "\n" in other compilers
 #if defined(_WIN32) || defined(WIN32)
@@ -33,33 +145,815 @@ void clearScreen() { system("CLS"); }
 void clearScreen() { cout << string(50, '\n'); }
 #endif
 
-const vector <string> FULL_DECK = {
-	"AC", "AH", "AS", "AD",
-	"2C", "2H", "2S", "2D",
-	"3C", "3H", "3S", "3D",
-	"4C", "4H", "4S", "4D",
-	"5C", "5H", "5S", "5D",
-	"6C", "6H", "6S", "6D",
-	"7C", "7H", "7S", "7D",
-	"8C", "8H", "8S", "8D",
-	"9C", "9H", "9S", "9D",
-	"10C", "10H", "10S", "10D",
-	"JC", "JH", "JS", "JD",
-	"QC", "QH", "QS", "QD",
-	"KC", "KH", "KS", "KD",
-	"J", "J",
+/* CARDS */
+// A card is a single byte: suit * 13 + (rank - 1) for the 52 suited cards, and 52 and 53 for the two jokers.
+// Strings like "10C" or "J" are only used when printing cards or reading them from the console.
+typedef unsigned char Card;
+
+#define NUM_CARDS 54 // cards in a full deck including jokers
+#define NUM_RANKS 13 // ranks per suit (A-K)
+
+const Card JOKER_1 = 52; // first joker
+const Card JOKER_2 = 53; // second joker
+const Card NO_CARD = 255; // no card (ex. nothing drawn yet)
+const Card END_OF_SUIT = 14; // value after a King or before an Ace (ends a series)
+
+// a table the compiler works out, read like an array
+template <class T, int N>
+struct LookupTable {
+	T at[N];
+	constexpr const T& operator[](int i) const { return at[i]; }
+};
+
+// rank of each card (Joker = 0, A = 1, ..., K = 13)
+constexpr LookupTable<int, NUM_CARDS> makeRankOf() {
+	LookupTable<int, NUM_CARDS> table = {};
+	for (int card = 0; card < NUM_CARDS; card++)
+		table.at[card] = (card < JOKER_1 ? card % NUM_RANKS + 1 : 0);
+	return table;
+}
+constexpr LookupTable<int, NUM_CARDS> RANK_OF = makeRankOf();
+
+// points for each rank (Joker = 0, A = 1, 2-10 are their value, face cards = 10)
+constexpr LookupTable<int, NUM_RANKS + 1> makePointsForRank() {
+	LookupTable<int, NUM_RANKS + 1> table = {};
+	for (int rank = 0; rank <= NUM_RANKS; rank++)
+		table.at[rank] = (rank < 10 ? rank : 10);
+	return table;
+}
+constexpr LookupTable<int, NUM_RANKS + 1> POINTS_FOR_RANK = makePointsForRank();
+
+// points of each card
+constexpr LookupTable<int, NUM_CARDS> makePointsOf() {
+	LookupTable<int, NUM_CARDS> table = {};
+	for (int card = 0; card < NUM_CARDS; card++)
+		table.at[card] = POINTS_FOR_RANK[RANK_OF[card]];
+	return table;
+}
+constexpr LookupTable<int, NUM_CARDS> POINTS_OF = makePointsOf();
+
+// points of a series of the lowest n ranks of a suit (a series from rank a + 1 to rank b is RUN_POINTS[b] - RUN_POINTS[a])
+constexpr LookupTable<int, NUM_RANKS + 1> makeRunPoints() {
+	LookupTable<int, NUM_RANKS + 1> table = {};
+	for (int rank = 1; rank <= NUM_RANKS; rank++)
+		table.at[rank] = table.at[rank - 1] + POINTS_FOR_RANK[rank];
+	return table;
+}
+constexpr LookupTable<int, NUM_RANKS + 1> RUN_POINTS = makeRunPoints();
+
+// rank after and before each rank in a series, END_OF_SUIT after a King or before an Ace
+constexpr LookupTable<int, END_OF_SUIT + 1> makeNextRank() {
+	LookupTable<int, END_OF_SUIT + 1> table = {};
+	for (int rank = 0; rank <= END_OF_SUIT; rank++)
+		table.at[rank] = (rank >= NUM_RANKS ? END_OF_SUIT : rank + 1);
+	return table;
+}
+constexpr LookupTable<int, END_OF_SUIT + 1> NEXT_RANK = makeNextRank();
+constexpr LookupTable<int, END_OF_SUIT + 1> makePrevRank() {
+	LookupTable<int, END_OF_SUIT + 1> table = {};
+	for (int rank = 0; rank <= END_OF_SUIT; rank++)
+		table.at[rank] = (rank <= 1 ? END_OF_SUIT : rank - 1);
+	return table;
+}
+constexpr LookupTable<int, END_OF_SUIT + 1> PREV_RANK = makePrevRank();
+
+// suit of each card as an index into SUIT_CHARS (4 for jokers)
+constexpr LookupTable<int, NUM_CARDS> makeSuitOf() {
+	LookupTable<int, NUM_CARDS> table = {};
+	for (int card = 0; card < NUM_CARDS; card++)
+		table.at[card] = (card < JOKER_1 ? card / NUM_RANKS : 4);
+	return table;
+}
+constexpr LookupTable<int, NUM_CARDS> SUIT_OF = makeSuitOf();
+
+const char SUIT_CHARS[] = "CHSDJ";
+const string RANK_NAMES[NUM_RANKS + 1] = { "", "A", "2", "3", "4", "5", "6", "7", "8", "9", "10", "J", "Q", "K" };
+
+inline bool isJoker(Card card) { return card == JOKER_1 || card == JOKER_2; }
+inline Card makeCard(int rank, int suit) { return (Card)(suit * NUM_RANKS + rank - 1); }
+
+const vector <Card> NO_CARDS; // nothing available to take
+const vector <Card> FULL_DECK = {
+	0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, // AC-KC
+	13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, // AH-KH
+	26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, // AS-KS
+	39, 40, 41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, // AD-KD
+	JOKER_1, JOKER_2,
+};
+
+/* RANDOM NUMBERS */
+// xoshiro256** generator (Blackman & Vigna), every game owns one so games never share random state
+// and any game can be played again from its seed
+struct Random {
+	unsigned long long state[4];
+
+	Random() { seed(0); }
+
+	void seed(unsigned long long seed) {
+		// expand the seed with splitmix64 so nearby seeds give unrelated games
+		for (int i = 0; i < 4; i++) {
+			unsigned long long z = (seed += 0x9E3779B97F4A7C15ULL);
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+			state[i] = z ^ (z >> 31);
+		}
+	}
+
+	unsigned long long next() {
+		unsigned long long result = rotate(state[1] * 5, 7) * 9;
+		unsigned long long t = state[1] << 17;
+		state[2] ^= state[0];
+		state[3] ^= state[1];
+		state[1] ^= state[2];
+		state[0] ^= state[3];
+		state[2] ^= t;
+		state[3] = rotate(state[3], 45);
+		return result;
+	}
+
+	// random number from 0 to n - 1 (multiply-shift, bias is under n / 2^32)
+	int below(int n) {
+		return (int)(((next() >> 32) * (unsigned long long)n) >> 32);
+	}
+
+	static unsigned long long rotate(unsigned long long x, int k) { return (x << k) | (x >> (64 - k)); }
+};
+
+/* CARD SETS */
+// A set of cards is a 64-bit mask with bit n set when card n is in the set.
+// Each suit is a 13-bit lane (bit 0 = Ace), so series are runs of bits in one lane, and bits 52 and 53 are the jokers.
+typedef unsigned long long CardSet;
+
+#define SUIT_LANE 0x1FFFULL // bits of one suit (A-K)
+
+const CardSet JOKER_BITS = 3ULL << JOKER_1; // both jokers
+const CardSet SUITED_BITS = (1ULL << JOKER_1) - 1; // all 52 suited cards
+
+// the four cards of each rank (empty for rank 0, use JOKER_BITS for jokers)
+constexpr LookupTable<CardSet, NUM_RANKS + 1> makeRankMask() {
+	LookupTable<CardSet, NUM_RANKS + 1> table = {};
+	for (int rank = 1; rank <= NUM_RANKS; rank++) {
+		for (int suit = 0; suit < 4; suit++)
+			table.at[rank] |= 1ULL << (suit * NUM_RANKS + rank - 1);
+	}
+	return table;
+}
+constexpr LookupTable<CardSet, NUM_RANKS + 1> RANK_MASK = makeRankMask();
+
+// ranks from the lowest to the highest card of each suit lane, a series of n cards with jokers in the gaps fits if this is at most n
+constexpr LookupTable<unsigned char, 1 << NUM_RANKS> makeLaneSpan() {
+	LookupTable<unsigned char, 1 << NUM_RANKS> table = {};
+	for (int lane = 1; lane < (1 << NUM_RANKS); lane++) {
+		int low = 0, high = NUM_RANKS - 1;
+		while (!(lane >> low & 1))
+			++low;
+		while (!(lane >> high & 1))
+			--high;
+		table.at[lane] = (unsigned char)(high - low + 1);
+	}
+	return table;
+}
+constexpr LookupTable<unsigned char, 1 << NUM_RANKS> LANE_SPAN = makeLaneSpan();
+
+#if defined(_MSC_VER)
+inline int countCards(CardSet set) { return (int)__popcnt64(set); }
+inline int lowestCard(CardSet set) { unsigned long i; _BitScanForward64(&i, set); return (int)i; }
+#else
+inline int countCards(CardSet set) { return __builtin_popcountll(set); }
+inline int lowestCard(CardSet set) { return __builtin_ctzll(set); }
+#endif
+
+inline CardSet cardBit(Card card) { return 1ULL << card; }
+inline unsigned suitLane(CardSet set, int suit) { return (unsigned)((set >> (suit * NUM_RANKS)) & SUIT_LANE); }
+// a set with no suited cards and at least one joker
+inline bool onlyJokers(CardSet set) { return set && !(set & SUITED_BITS); }
+
+CardSet toCardSet(const vector <Card> &cards) {
+	CardSet set = 0;
+	for (size_t i = 0; i < cards.size(); i++)
+		set |= cardBit(cards[i]);
+	return set;
+}
+
+// points of all cards in a set
+int pointsInSet(CardSet set) {
+	int sum = 0;
+	for (set &= SUITED_BITS; set; set &= set - 1)
+		sum += POINTS_OF[lowestCard(set)];
+	return sum;
+}
+
+// true if the cards can be discarded together: a single or multiples (jokers go with any), or a series of 3 or more in one suit with jokers in the gaps
+bool isDiscardSet(CardSet cards) {
+	CardSet suited = cards & SUITED_BITS;
+	if (!suited || !(suited & ~RANK_MASK[RANK_OF[lowestCard(suited)]])) {
+		return true;
+	}
+	int suit = SUIT_OF[lowestCard(suited)];
+	int size = countCards(cards);
+	if (size < 3 || size > NUM_RANKS || (suited & ~(SUIT_LANE << (suit * NUM_RANKS)))) {
+		return false;
+	}
+	return LANE_SPAN[suitLane(suited, suit)] <= size;
+}
+
+// the multiples and series a set of cards without jokers can discard, worked out once per hand
+// getBestDiscard answers every query on the hand (alone or with each face-up card added) from it, only redoing the rank and suit the added card is in
+struct DiscardScan {
+	CardSet cards = ~0ULL; // set scanned, ~0 before the first scan
+	int rankCount[NUM_RANKS + 1];
+	int seriesPoints[4]; // points of the best series in each suit, 0 if there is none
+	unsigned seriesBits[4]; // cards of that series in the suit lane
+	void scan(CardSet);
+	static void bestSeries(unsigned, int&, unsigned&);
+	int best(Card, bool, CardSet&) const;
+};
+
+void DiscardScan::scan(CardSet set) {
+	cards = set;
+	for (int k = 1; k <= NUM_RANKS; k++)
+		rankCount[k] = countCards(set & RANK_MASK[k]);
+	for (int suit = 0; suit < 4; suit++)
+		bestSeries(suitLane(set, suit), seriesPoints[suit], seriesBits[suit]);
+}
+
+// the series of 3 or more in a suit lane with the most points (the lowest one if tied), a series is best started at the bottom of its run
+void DiscardScan::bestSeries(unsigned lane, int &points, unsigned &bits) {
+	points = 0;
+	bits = 0;
+	for (unsigned starts = lane & ~(lane << 1); starts; starts &= starts - 1) {
+		int first = lowestCard(starts);
+		int end = first + lowestCard(~(lane >> first));
+		if (end - first >= 3 && RUN_POINTS[end] - RUN_POINTS[first] > points) {
+			points = RUN_POINTS[end] - RUN_POINTS[first];
+			bits = (SUIT_LANE >> (NUM_RANKS - (end - first))) << first;
+		}
+	}
+}
+
+// points of the best discard of the scanned cards plus draw (NO_CARD for none), 0 if nothing can be discarded
+// singles may be discarded unless the card is being taken, multiples come before series and lower series before higher ones when tied
+int DiscardScan::best(Card draw, bool singles, CardSet &discard) const {
+	int rank = -1, suit = -1;
+	CardSet all = cards;
+	if (draw != NO_CARD && !(cards & cardBit(draw))) {
+		rank = RANK_OF[draw];
+		suit = SUIT_OF[draw];
+		all |= cardBit(draw);
+	}
+	int bestPoints = 0;
+	for (int k = 1; k <= NUM_RANKS; k++) {
+		int count = rankCount[k] + (k == rank);
+		if ((count > 1 || (singles && count)) && count * POINTS_FOR_RANK[k] > bestPoints) {
+			bestPoints = count * POINTS_FOR_RANK[k];
+			discard = all & RANK_MASK[k];
+		}
+	}
+	int bestSuit = -1, points = 0;
+	unsigned bits = 0, drawSuitBits = 0;
+	int drawSuitPoints = 0;
+	if (suit >= 0)
+		bestSeries(suitLane(all, suit), drawSuitPoints, drawSuitBits);
+	for (int i = 0; i < 4; i++) {
+		int p = (i == suit ? drawSuitPoints : seriesPoints[i]);
+		unsigned b = (i == suit ? drawSuitBits : seriesBits[i]);
+		if (p > points || (p == points && p && (b & (0 - b)) < (bits & (0 - bits)))) {
+			points = p;
+			bits = b;
+			bestSuit = i;
+		}
+	}
+	if (points > bestPoints) {
+		bestPoints = points;
+		discard = (CardSet)bits << (bestSuit * NUM_RANKS);
+	}
+	return bestPoints;
+}
+
+// what a player can work out about the cards they haven't seen: not in their hand, not in the discard pile and not drawn publicly
+struct CardKnowledge {
+	CardSet unseen;
+	int count;
+	int points;
+	int rankCount[NUM_RANKS + 1]; // unseen cards of each value (jokers are 0)
+	CardKnowledge() { reset(); }
+	void reset(); // new round, nothing seen
+	void see(Card); // card was dealt to the player or turned face up
+	void forget(Card); // card was shuffled back into the deck
+	void restore(CardSet); // back to not having seen exactly the cards in the set
+	float average() const;
 };
 
+void CardKnowledge::reset() {
+	unseen = SUITED_BITS | JOKER_BITS;
+	count = NUM_CARDS;
+	points = pointsInSet(unseen);
+	rankCount[0] = 2;
+	fill(rankCount + 1, rankCount + NUM_RANKS + 1, 4);
+}
+
+void CardKnowledge::see(Card card) {
+	if (!(unseen & cardBit(card))) {
+		return; // already known (ex. player discarding their own card)
+	}
+	unseen &= ~cardBit(card);
+	--count;
+	points -= POINTS_OF[card];
+	--rankCount[RANK_OF[card]];
+}
+
+void CardKnowledge::forget(Card card) {
+	if (unseen & cardBit(card)) {
+		return;
+	}
+	unseen |= cardBit(card);
+	++count;
+	points += POINTS_OF[card];
+	++rankCount[RANK_OF[card]];
+}
+
+void CardKnowledge::restore(CardSet previous) {
+	for (CardSet changed = previous ^ unseen; changed; changed &= changed - 1) {
+		Card card = lowestCard(changed);
+		if (previous & cardBit(card))
+			forget(card);
+		else
+			see(card);
+	}
+}
+
+float CardKnowledge::average() const {
+	return (count ? (float)points / count : 0);
+}
+
 struct Player {
 	bool AI = false;
 	string name;
-	vector <string> hand;
+	vector <Card> hand; // only changed through addCard, removeCard and clearHand
 	int score = 0;
 	int pointsInRound = 0;
 	bool stillPlaying = true;
-	vector <string> cardsDrawnPublicly; // to help AI suspect Assaf
+	vector <Card> cardsDrawnPublicly; // to help AI suspect Assaf
+	int playouts = 0; // rollouts per decision if this AI searches, 0 plays by the heuristic
+	double budget = 0; // ms a search may take per decision, 0 for no limit
+	CardKnowledge knowledge; // cards this player hasn't seen
+	// kept up to date as cards come and go so they never have to be counted again
+	int handPoints = 0;
+	CardSet handSet = 0;
+	void addCard(Card);
+	void removeCard(Card);
+	void insertCard(Card, size_t); // puts a card back where it was taken out of the hand
+	void clearHand();
+};
+
+void Player::addCard(Card card) {
+	hand.push_back(card);
+	handPoints += POINTS_OF[card];
+	handSet |= cardBit(card);
+}
+
+void Player::removeCard(Card card) {
+	hand.erase(find(hand.begin(), hand.end(), card));
+	handPoints -= POINTS_OF[card];
+	handSet &= ~cardBit(card);
+}
+
+void Player::insertCard(Card card, size_t position) {
+	addCard(card);
+	rotate(hand.begin() + position, hand.end() - 1, hand.end());
+}
+
+void Player::clearHand() {
+	hand.clear();
+	handPoints = 0;
+	handSet = 0;
+}
+
+// where the card picked up at the end of a turn comes from
+enum DrawSource { DRAW_PILE, DISCARD_PILE };
+
+// a turn that doesn't call Yaniv, applied the same way for humans and AIs
+struct Move {
+	vector <Card> discards; // in the order they are played (series go from low to high)
+	DrawSource source = DRAW_PILE;
+	Card take = NO_CARD; // card taken from the top of the discard pile
+	bool slapdown = false; // slap down the card drawn from the draw pile if it matches the discards
+	bool jokerSwap = false; // take is a joker swapped out of a series for the one card discarded
+};
+
+// what a move made with makeMove changed, so unmakeMove can take it back without copying the game
+struct UndoRecord {
+	unsigned char player = 0; // who moved
+	bool played = false; // false if the move wasn't legal and the player only passed the turn
+	bool reshuffled = false; // the draw pile was empty and the discard pile was shuffled into it
+	bool slapdown = false;
+	unsigned char numAvailable = 0; // cards that could be taken before the move
+	unsigned char numDiscards = 0;
+	Card take = NO_CARD;
+	unsigned char takenFrom = 0; // where take was in the discard pile
+	Card drawn = NO_CARD;
+	unsigned char drawnUnseen = 0; // players who hadn't seen the card on top of the draw pile
+	unsigned char faceUpTakes = 0;
+	// where the rest starts in undoBytes: the cards that could be taken, then for each discard the card, its place in the hand,
+	// its place in the cards drawn publicly (NO_CARD if not there) and the players who hadn't seen it, then if reshuffled
+	// the random numbers, the discard pile and the cards each player hadn't seen
+	size_t bytes = 0;
+};
+
+// rollouts of one choice a search AI can make, shared by every thread searching
+struct ActionStats {
+	atomic <long long> visits{0};
+	atomic <long long> reward{0}; // sum of rewards times REWARD_SCALE
+};
+
+// who won a round that ended with a Yaniv call
+struct RoundResult {
+	int caller = 0; // player who called Yaniv
+	int nextPlayer = 0; // winner who starts the next round
+	vector <int> handPoints; // points in each player's hand when Yaniv was called
+	vector <int> winners; // players with the lowest hand (more than one if tied)
+	vector <int> assafers; // players who Assaf-ed the caller (empty if not Assaf-ed)
+	vector <bool> scoreReduced; // if player's score landed on a multiple of 50
+	vector <bool> eliminated; // if player went over the points limit this round
+};
+
+// a caller who got Assaf-ed in a simulated game
+struct AssafEvent {
+	int round = 0;
+	int caller = 0;
+	int callerPoints = 0;
+	vector <int> assafers;
+};
+
+// outcome of a game played without any console I/O
+struct GameResult {
+	unsigned long long seed = 0; // plays the same game again with startGame
+	int winner = -1;
+	int rounds = 0;
+	int turns = 0;
+	int stalledRounds = 0; // rounds redealt after MAX_TURNS_PER_ROUND
+	vector <vector <int> > roundScores; // every player's score at the end of each round
+	vector <AssafEvent> assafs;
+	vector <float> decisionMs; // time each decision of a search AI took
+};
+
+// ways to choose k of n cards, used to number the hands in the discard table
+struct Binomials {
+	long long of[NUM_CARDS + 1][DISCARD_TABLE_CARDS + 1];
 };
 
+constexpr Binomials makeBinomials() {
+	Binomials table = {};
+	for (int n = 0; n <= NUM_CARDS; n++) {
+		table.of[n][0] = 1;
+		for (int k = 1; k <= DISCARD_TABLE_CARDS; k++)
+			table.of[n][k] = (n ? table.of[n - 1][k - 1] + table.of[n - 1][k] : 0);
+	}
+	return table;
+}
+constexpr Binomials CHOOSE = makeBinomials();
+
+// start of a discard table file, the entries follow
+struct DiscardTableHeader {
+	char magic[8] = {'Y', 'A', 'N', 'I', 'V', 'B', 'D', 0};
+	unsigned version = DISCARD_TABLE_VERSION;
+	unsigned minToCallYaniv = 0; // the only rule getBestDiscard looks at when there is nothing to take
+	unsigned maxCards = DISCARD_TABLE_CARDS;
+	unsigned entries = 0;
+};
+
+// best discard of every hand of up to DISCARD_TABLE_CARDS cards with nothing to take, one byte per hand
+// hands of k cards come after all smaller hands in the order of their bits (so a hand's index is worked out, never searched for)
+// and bit i of a hand's byte is set if its i-th lowest card is discarded
+class DiscardTable {
+public:
+	DiscardTable() {}
+	DiscardTable(const DiscardTable&) = delete;
+	DiscardTable& operator=(const DiscardTable&) = delete;
+	~DiscardTable() { unload(); }
+	int minToCallYaniv = -1; // rules the table was made for, -1 if nothing is loaded
+	static long long index(CardSet);
+	static long long size() { return index((1ULL << NUM_CARDS) - (1ULL << (NUM_CARDS - DISCARD_TABLE_CARDS))) + 1; }
+	bool load(const string&);
+	bool save(const string&) const;
+	void generate(int);
+	bool lookup(CardSet, int, CardSet&) const;
+private:
+	const unsigned char *entries = NULL;
+	vector <unsigned char> generated; // entries made by generate (or read without mmap)
+	void *mapped = NULL;
+	size_t mappedSize = 0;
+	void unload();
+};
+
+long long DiscardTable::index(CardSet hand) {
+	int size = countCards(hand);
+	long long index = 0;
+	for (int k = 1; k < size; k++)
+		index += CHOOSE.of[NUM_CARDS][k];
+	for (int i = 1; hand; hand &= hand - 1, i++)
+		index += CHOOSE.of[lowestCard(hand)][i];
+	return index;
+}
+
+void DiscardTable::unload() {
+#if !defined(_WIN32) && !defined(WIN32)
+	if (mapped) {
+		munmap(mapped, mappedSize);
+	}
+#endif
+	mapped = NULL;
+	mappedSize = 0;
+	generated.clear();
+	entries = NULL;
+	minToCallYaniv = -1;
+}
+
+// maps the file into memory so every process playing games shares one copy, false if it is missing or was made by another version
+bool DiscardTable::load(const string &path) {
+	unload();
+	DiscardTableHeader expected;
+	size_t bytes = sizeof(DiscardTableHeader) + size();
+	const unsigned char *data = NULL;
+#if !defined(_WIN32) && !defined(WIN32)
+	int file = open(path.c_str(), O_RDONLY);
+	if (file < 0) {
+		return false;
+	}
+	struct stat info;
+	if (fstat(file, &info) == 0 && (size_t)info.st_size == bytes) {
+		mapped = mmap(NULL, bytes, PROT_READ, MAP_SHARED, file, 0);
+		if (mapped == MAP_FAILED) {
+			mapped = NULL;
+		}
+	}
+	close(file);
+	if (!mapped) {
+		return false;
+	}
+	mappedSize = bytes;
+	data = (const unsigned char*)mapped;
+#else
+	ifstream file(path, ios::binary);
+	generated.resize(bytes);
+	if (!file.read((char*)generated.data(), bytes) || file.peek() != EOF) {
+		generated.clear();
+		return false;
+	}
+	data = generated.data();
+#endif
+	const DiscardTableHeader &header = *(const DiscardTableHeader*)data;
+	if (!equal(header.magic, header.magic + 8, expected.magic) || header.version != expected.version || header.maxCards != expected.maxCards || header.entries != (unsigned)size()) {
+		unload();
+		return false;
+	}
+	minToCallYaniv = header.minToCallYaniv;
+	entries = data + sizeof(DiscardTableHeader);
+	return true;
+}
+
+bool DiscardTable::save(const string &path) const {
+	DiscardTableHeader header;
+	header.minToCallYaniv = minToCallYaniv;
+	header.entries = (unsigned)size();
+	ofstream file(path, ios::binary);
+	file.write((const char*)&header, sizeof(header));
+	file.write((const char*)entries, size());
+	return (bool)file;
+}
+
+// discard is set to the best discard of hand if the table has it and was made with these rules
+// hands of only jokers aren't looked up, which one is played depends on the order they are held in
+bool DiscardTable::lookup(CardSet hand, int rulesMinToCallYaniv, CardSet &discard) const {
+	int size = countCards(hand);
+	if (!entries || rulesMinToCallYaniv != minToCallYaniv || size > DISCARD_TABLE_CARDS || !(hand & SUITED_BITS)) {
+		return false;
+	}
+	unsigned char played = entries[index(hand)];
+	discard = 0;
+	for (; hand; hand &= hand - 1, played >>= 1) {
+		if (played & 1)
+			discard |= hand & (0 - hand);
+	}
+	return true;
+}
+
+// start of a game record file, recorded games follow one after another
+struct RecordFileHeader {
+	char magic[8] = {'Y', 'A', 'N', 'I', 'V', 'G', 'R', 0};
+	unsigned version = RECORD_VERSION;
+};
+
+// start of a block of recorded games, written each time a RecordWriter writes out what it holds
+// so readers can find every block and share them out without reading the headers of all the games first
+struct RecordBlockHeader {
+	unsigned long long bytes = 0; // bytes of games after the header
+};
+
+// start of a recorded game, its events follow
+struct GameRecordHeader {
+	unsigned long long seed = 0; // plays the same game again with startGame
+	unsigned bytes = 0; // bytes of events after the header, so a reader can skip to the next game
+	unsigned short assafPenalty = 0, extraAssafPenalties = 0, pointsLimit = 0;
+	unsigned char players = 0, cardsAtStart = 0, minToCallYaniv = 0;
+	unsigned char variations = 0; // slapdown, joker swap, middle take and halving as bits 3 to 0, like the compiled engines are numbered
+	unsigned char reserved[2] = {}; // written as 0, fills what would be padding so no uninitialized bytes reach the file
+};
+static_assert(sizeof(GameRecordHeader) == 24, "game record header has padding");
+
+// the high 3 bits of an event's first byte, the low 5 bits hold a player or flags
+// DEAL | first player: for each player the number of cards dealt and the cards, then the face-up card
+// TURN | flags: player << 5 | number of discards, the discards in the order played, then the card drawn (NO_CARD if there were none left)
+// YANIV | caller: points in the caller's hand, cards in the caller's hand, bit mask of the players who Assaf-ed them
+// SCORES | next player: bit masks of the players whose score was reduced and who went out, then every score as 2 bytes (low byte first)
+// END | winner: the last event of a game
+// SNAPSHOT: its length as 2 bytes (low byte first), then the game state before a turn (see Yaniv::recordSnapshot)
+// a round redealt because the AIs got stuck ends with a TURN followed by a DEAL
+enum RecordEvent { EVENT_DEAL = 0x00, EVENT_TURN = 0x20, EVENT_YANIV = 0x40, EVENT_SCORES = 0x60, EVENT_END = 0x80, EVENT_SNAPSHOT = 0xA0 };
+enum TurnFlags { TOOK_DISCARD = 1, SLAPPED_DOWN = 2, SWAPPED_JOKER = 4 }; // a slapped down card is the card drawn
+
+// appends the games one worker thread records to its own file, a whole game at a time
+class RecordWriter {
+public:
+	RecordWriter() {}
+	RecordWriter(const RecordWriter&) = delete;
+	RecordWriter& operator=(const RecordWriter&) = delete;
+	~RecordWriter() { flush(); }
+	bool open(const string&);
+	void write(const vector<unsigned char>&);
+	void flush();
+private:
+	ofstream file;
+	vector <unsigned char> buffer;
+};
+
+// false if the file can't be written or is a record file of another version
+bool RecordWriter::open(const string &path) {
+	RecordFileHeader expected, header;
+	ifstream existing(path, ios::binary);
+	bool empty = !existing || existing.peek() == EOF;
+	if (!empty && (!existing.read((char*)&header, sizeof(header)) || !equal(header.magic, header.magic + 8, expected.magic) || header.version != expected.version)) {
+		return false;
+	}
+	existing.close();
+	file.open(path, ios::binary | ios::app);
+	if (empty) {
+		file.write((const char*)&expected, sizeof(expected));
+	}
+	buffer.reserve(RECORD_BUFFER_BYTES);
+	return (bool)file;
+}
+
+void RecordWriter::write(const vector<unsigned char> &game) {
+	buffer.insert(buffer.end(), game.begin(), game.end());
+	if (buffer.size() >= RECORD_BUFFER_BYTES) {
+		flush();
+	}
+}
+
+void RecordWriter::flush() {
+	if (buffer.size()) {
+		RecordBlockHeader block;
+		block.bytes = buffer.size();
+		file.write((const char*)&block, sizeof(block));
+		file.write((const char*)buffer.data(), buffer.size());
+		file.flush();
+		buffer.clear();
+	}
+}
+
+// a game record file mapped into memory, its games are read in place without copying them
+class RecordFile {
+public:
+	RecordFile() {}
+	RecordFile(const RecordFile&) = delete;
+	RecordFile& operator=(const RecordFile&) = delete;
+	~RecordFile() { unload(); }
+	size_t size = 0;
+	vector <size_t> blockStarts, blockEnds; // where the games of each block start and end
+	bool load(const string&);
+	bool nextGame(size_t&, GameRecordHeader&, const unsigned char*&) const;
+private:
+	const unsigned char *data = NULL;
+	vector <unsigned char> loaded; // the file if it couldn't be mapped
+	void *mapped = NULL;
+	void unload();
+};
+
+void RecordFile::unload() {
+#if !defined(_WIN32) && !defined(WIN32)
+	if (mapped) {
+		munmap(mapped, size);
+	}
+#endif
+	mapped = NULL;
+	loaded.clear();
+	data = NULL;
+	size = 0;
+	blockStarts.clear();
+	blockEnds.clear();
+}
+
+// false if the file is missing or isn't a record file of this version
+bool RecordFile::load(const string &path) {
+	unload();
+	RecordFileHeader expected;
+#if !defined(_WIN32) && !defined(WIN32)
+	int file = open(path.c_str(), O_RDONLY);
+	if (file < 0) {
+		return false;
+	}
+	struct stat info;
+	if (fstat(file, &info) == 0 && (size_t)info.st_size >= sizeof(RecordFileHeader)) {
+		mapped = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, file, 0);
+		if (mapped == MAP_FAILED) {
+			mapped = NULL;
+		}
+	}
+	close(file);
+	if (!mapped) {
+		return false;
+	}
+	madvise(mapped, info.st_size, MADV_SEQUENTIAL); // games are read once, front to back
+	size = info.st_size;
+	data = (const unsigned char*)mapped;
+#else
+	ifstream file(path, ios::binary | ios::ate);
+	if (!file) {
+		return false;
+	}
+	loaded.resize((size_t)file.tellg());
+	file.seekg(0);
+	if (loaded.size() < sizeof(RecordFileHeader) || !file.read((char*)loaded.data(), loaded.size())) {
+		loaded.clear();
+		return false;
+	}
+	size = loaded.size();
+	data = loaded.data();
+#endif
+	RecordFileHeader header;
+	memcpy(&header, data, sizeof(header));
+	if (!equal(header.magic, header.magic + 8, expected.magic) || header.version != expected.version) {
+		unload();
+		return false;
+	}
+	// hop from block to block (one header per RECORD_BUFFER_BYTES written), a block cut short by a run that didn't finish writing ends with the file
+	for (size_t offset = sizeof(RecordFileHeader); size - offset >= sizeof(RecordBlockHeader); offset = blockEnds.back()) {
+		RecordBlockHeader block;
+		memcpy(&block, data + offset, sizeof(block));
+		offset += sizeof(block);
+		blockStarts.push_back(offset);
+		blockEnds.push_back(block.bytes < size - offset ? offset + block.bytes : size);
+	}
+	return true;
+}
+
+// reads the game at offset (0 for the first game) and moves offset to the next one, false when there are no more
+// a game cut short by a run that didn't finish writing is left out
+bool RecordFile::nextGame(size_t &offset, GameRecordHeader &header, const unsigned char *&events) const {
+	// the game is in the first block that ends after offset, or starts that block if offset is before it
+	size_t block = upper_bound(blockEnds.begin(), blockEnds.end(), offset) - blockEnds.begin();
+	if (block == blockEnds.size()) {
+		return false;
+	}
+	offset = max(offset, blockStarts[block]);
+	size_t end = blockEnds[block];
+	if (end - offset < sizeof(GameRecordHeader)) {
+		return false;
+	}
+	memcpy(&header, data + offset, sizeof(header)); // games aren't aligned
+	if (end - offset - sizeof(GameRecordHeader) < header.bytes) {
+		return false;
+	}
+	events = data + offset + sizeof(GameRecordHeader);
+	offset += sizeof(GameRecordHeader) + header.bytes;
+	return true;
+}
+
+// the rules a recorded game was played with
+Rules recordedRules(const GameRecordHeader &header) {
+	Rules rules;
+	rules.cardsAtStart = header.cardsAtStart;
+	rules.minToCallYaniv = header.minToCallYaniv;
+	rules.assafPenalty = header.assafPenalty;
+	rules.extraAssafPenalties = header.extraAssafPenalties;
+	rules.pointsLimit = header.pointsLimit;
+	rules.canSlapdown = header.variations & 8;
+	rules.canSwapJoker = header.variations & 4;
+	rules.canTakeFromMiddleOfSet = header.variations & 2;
+	rules.reductionIsHalf = header.variations & 1;
+	return rules;
+}
+
+// if games played with rules can be recorded: the header keeps the penalties and limit in 2 bytes and the rest in 1,
+// a Yaniv call's points (at most minToCallYaniv) take 1 byte and scores 2, and no score gets past the limit by more than one round's worth
+bool recordFits(const Rules &rules) {
+	int worstRound = pointsInSet(SUITED_BITS | JOKER_BITS) + rules.assafPenalty + rules.extraAssafPenalties * (MAX_PLAYERS - 1);
+	return rules.cardsAtStart >= 0 && rules.cardsAtStart <= 0xFF && rules.minToCallYaniv >= 0 && rules.minToCallYaniv <= 0xFF
+		&& rules.assafPenalty >= 0 && rules.assafPenalty <= 0xFFFF && rules.extraAssafPenalties >= 0 && rules.extraAssafPenalties <= 0xFFFF
+		&& rules.pointsLimit >= 0 && rules.pointsLimit + worstRound <= 0xFFFF;
+}
+
 class Yaniv {
 public:
 	int numPlayers = 0;
@@ -67,42 +961,293 @@ public:
 	int currentPlayer = 0;
 	int remainingPlayers;
 	vector <Player> players;
-	vector <string> discardPile;
-	vector <string> availableToTake;
-	vector <string> nextAvailableToTake;
+	vector <Card> discardPile;
+	vector <Card> availableToTake;
+	vector <Card> nextAvailableToTake;
 	vector <string> history;
-	vector <string> deck = FULL_DECK;
+	vector <Card> deck = FULL_DECK;
+	Rules rules; // rule variations for this game
+	Random rng; // each game has its own random numbers so games can run on separate threads
+	Random aiRng; // random numbers of AI decisions, kept apart from the cards' so a replay deals the same cards without deciding again
+	int turnsPlayed = 0; // turns of this game so far, each simulated decision is seeded from the game's seed and this
+	int faceUpTakes = 0; // turns in a row that ended taking a face-up card (up to 255), everyone sees this
+	unsigned long long seed = 0; // seed the current game was started with
+	int searchThreads = 1; // threads a search AI plays its rollouts on
+	const DiscardTable *discardTable = NULL; // best discards worked out ahead of time, NULL to always work them out
+	DiscardScan discardScan; // discards of the last hand without jokers getBestDiscard was asked about
+	// cards the AI works with while choosing a move, kept between turns so turns don't allocate
+	vector <Card> bestOfHand, bestWithTaking, savedCards, bestOfSaved, bestOfSavedWithTaking;
+	// endgame look-ahead: the cards the AI hasn't seen and chances of the AI being Assaf-ed with p points
+	CardKnowledge endgameUnseen;
+	float endgameRisk[ENDGAME_CARDS * 10 + 1];
+	float endgameRoundEnds = 0; // chance another player can call Yaniv before the AI's next turn
+	vector <Card> endgameDiscards;
+	Move simulatedMove; // reused every simulated turn so its discards keep their room
+	// moves made with makeMove that can still be taken back, most recent last
+	vector <UndoRecord> undoLog;
+	vector <unsigned char> undoBytes;
+	vector <Card> undoHand, undoPublic; // where makeMove works out the places cards are taken from
+	RecordWriter *recorder = NULL; // file of the worker thread playing this game, NULL to not record games
+	vector <unsigned char> record; // events of the game being played, written out when it ends
 	int playGame();
+	void startGame(unsigned long long);
+	GameResult simulateGame(bool = false);
+	template <class R> GameResult simulateGameWith();
+	void startTurn(GameResult&, int&);
+	template <class R> bool simulateTurn(GameResult&, int&);
+	template <class R = RuntimeRules> bool decideTurn(Player&, Move&);
+	bool finishRound(GameResult&, const RoundResult&, int, int&);
+	void beginRecord();
+	void recordDeal();
+	void recordTurn(const Move&, Card, Card);
+	void recordRound(const RoundResult&, int);
+	void endRecord(int);
+	void recordSnapshot();
+	const unsigned char *restoreSnapshot(const unsigned char*);
+	int replay(const GameRecordHeader&, const unsigned char*, int);
+	bool sameState(const Yaniv&) const;
 	void makePlayers();
+	void makeAIPlayers(int);
 	void dealCards(Player&, int = 1);
-	void printVector(vector<string>);
-	bool checkDiscards(Player&, string);
-	string prevValue(string);
-	string nextValue(string&);
-	bool checkDraw(Player&, string, string&);
-	string getValue(string);
-	char getSuit(string);
-	int getOrder(vector <string>, int);
-	void sortCards(vector <string>&);
-	int pointsForCard(string);
-	int countPoints(vector<string>);
+	void reshuffleDiscards();
+	void printVector(const vector<Card>&);
+	bool parseDiscards(const Player&, string, vector<Card>&);
+	template <class R = RuntimeRules> bool parseDraw(string, Move&);
+	bool canDiscard(const Player&, const vector<Card>&, Card&);
+	template <class R = RuntimeRules> bool canTake(const vector<Card>&, Card, bool&);
+	bool matchesDiscards(Card);
+	template <class R = RuntimeRules> bool validateMove(const Player&, const Move&, Card&);
+	template <class R = RuntimeRules> Card applyMove(Player&, const Move&, Card&);
+	template <class R = RuntimeRules> bool makeMove(const Move&);
+	void unmakeMove();
+	template <class R = RuntimeRules> void legalMoves(const Player&, vector<Move>&);
+	void legalDiscards(const vector<Card>&, vector <vector <Card> >&);
+	void discardCards(Player&, const vector<Card>&);
+	void slapDown(Player&, Card);
+	void revealCard(Card);
+	int prevValue(int);
+	int nextValue(int);
+	int getValue(Card);
+	char getSuit(Card);
+	int getOrder(Card);
+	void sortCards(vector <Card>&);
+	void shuffleCards(vector <Card>&);
+	int pointsForCard(Card);
+	int countPoints(const vector<Card>&);
 	int callYaniv(Player&, int);
+	template <class R = RuntimeRules> int scoreRound(Player&, int, RoundResult&);
+	float averageOfUnknowns(int);
+	float assafRisk(int, int, float* = NULL, int = ASSAF_SAMPLES);
+	bool aiCallsYaniv(Player&, int);
+	template <class R = RuntimeRules> bool aiDecide(Player&, int, Move&);
+	template <class R = RuntimeRules> bool aiHeuristicDecide(Player&, int, Move&);
+	template <class R = RuntimeRules> bool endgameMove(Player&, int, Move&);
+	template <class R = RuntimeRules> float endgameNextTurn(CardSet);
+	void orderDiscards(CardSet, vector<Card>&);
+	template <class R = RuntimeRules> bool searchMove(Player&, int, Move&);
+	void determinize(const Yaniv&, int, unsigned long long);
+	void dealUnseen(const Yaniv&, int, unsigned long long);
+	template <class R = RuntimeRules> double playout(int, const Move*, const chrono::steady_clock::time_point*);
+	double roundReward(int, const RoundResult&);
+	template <class R = RuntimeRules> void aiChooseMove(Player&, Move&);
+	template <class R = RuntimeRules> bool aiTakeTurn(Player&, Move&, Card&, Card&);
 	void resetGame(int);
 	void resetRound(int);
 	void changeTurn();
-	int countCardInVector(vector<string>, string, vector<string>&);
-	vector <string> getBestDiscard(vector<string>, vector<string> = {""}, bool = true);
+	int countCardInVector(const vector<Card>&, int, vector<Card>&);
+	template <class R = RuntimeRules> void getBestDiscard(const vector<Card>&, const vector<Card>&, bool, vector<Card>&);
+};
+
+string cardToString(Card card);
+bool parseCard(string str, Card &card);
+// totals over simulated games (one per worker thread, merged at the end)
+struct SimulationStats {
+	long long games = 0;
+	long long rounds = 0;
+	long long turns = 0;
+	long long assafs = 0;
+	long long stalledRounds = 0;
+	unsigned long long longestSeed = 0; // seed of the game with the most turns
+	int longestTurns = 0;
+	vector <long long> wins; // games won by each seat
+	vector <float> decisionMs; // time each decision of a search AI took
+	void add(const GameResult&);
+	void merge(const SimulationStats&);
+};
+
+// totals over recorded games with the same rules
+struct RecordStats {
+	GameRecordHeader rules; // the header of the first game, seed and bytes aren't compared
+	long long games = 0;
+	long long rounds = 0; // rounds that ended with a Yaniv call
+	long long turns = 0; // turns of those rounds, including the Yaniv call
+	long long stalledRounds = 0;
+	long long assafs = 0;
+	long long roundScores = 0; // scores added to in a round (one per player still in)
+	long long reducedScores = 0; // of those, scores that landed on a multiple of 50
+	long long calls[RECORD_HAND_SIZES] = {}; // Yaniv calls by cards in the caller's hand
+	long long assafsBy[RECORD_HAND_SIZES] = {}; // Assafs by cards in the caller's hand
+	bool sameRules(const GameRecordHeader&) const;
+	void add(const GameRecordHeader&, const unsigned char*);
+	void merge(const RecordStats&);
 };
 
+// command line options for simulated games
+struct SimulationOptions {
+	long long games = 0;
+	int players = 4;
+	int threads = 1;
+	unsigned long long firstSeed = 0; // game i uses seed firstSeed + i
+	bool scaling = false; // also run with 1, 2, 4, ... threads and report speedup
+	bool sweep = false; // play every combination of the rule variations
+	bool runtimeRules = false; // look up the rule variations as the game goes instead of using the engine compiled for them
+	bool compareEngines = false; // time the compiled engine against the one that looks up the rules
+	int searchPlayers = 0; // the first this many AIs search instead of playing by the heuristic
+	int playouts = DEFAULT_PLAYOUTS; // rollouts per decision for AIs that search
+	int searchThreads = 1; // threads each search uses (games already run on every core)
+	double budget = 0; // ms a search AI may take per decision, 0 for no limit
+	bool bench = false; // run the benchmarks instead of games
+	bool selfTest = false; // check the engine against itself instead of playing games
+	string benchOut; // file to write benchmark results to as JSON
+	string baseline; // JSON file from an earlier run to compare the benchmark results with
+	double threshold = 10; // percent slower than the baseline that counts as a regression
+	string table = DISCARD_TABLE_FILE; // discard table to load
+	string genTable; // file to write a discard table to instead of playing
+	string record; // games are appended to record.0, record.1, ... (one file per worker thread), empty to not record them
+	string analyze; // read the games recorded to analyze.0, analyze.1, ... (or the file analyze) instead of playing
+	string replay; // rebuild a game recorded to replay.0, replay.1, ... (or the file replay) instead of playing
+	unsigned long long replayGame = 0; // seed of the game to rebuild
+	int replayTurn = 0; // turn to rebuild it at and decide again
+	const DiscardTable *discardTable = NULL; // the loaded discard table, NULL if there isn't one
+	Rules rules;
+};
+
+// time per operation of one benchmark
+struct BenchResult {
+	string name;
+	long long ops = 0;
+	double nsPerOp = 0;
+};
+
+void parallelFor(long long count, int numThreads, long long chunkSize, function<void(int, long long, long long)> work, vector <long long> *steals = NULL);
+void setUpGame(Yaniv &game, const SimulationOptions &options);
+bool openRecorders(const SimulationOptions &options, int numThreads, vector <RecordWriter*> &recorders);
+SimulationStats simulateGames(const SimulationOptions &options, int numThreads, vector <long long> *steals = NULL);
+int runSimulation(const SimulationOptions &options);
+int runSweep(const SimulationOptions &options);
+int compareEngines(const SimulationOptions &options);
+BenchResult timeBenchmark(string name, long long ops, function<long long()> work);
+int runBenchmarks(const SimulationOptions &options);
+void playAiTurns(Yaniv &game, int games, function<void()> beforeTurn, function<void()> afterTurn);
+bool checkTurnAllocations(Yaniv &game);
+bool checkHandTotals(Yaniv &game);
+bool checkRecords(Yaniv &game);
+bool checkReplays(Yaniv &game, const SimulationOptions &options);
+bool checkUndo(Yaniv &game);
+int runSelfTest(const SimulationOptions &options);
+int generateTable(const SimulationOptions &options);
+int analyzeRecords(const SimulationOptions &options);
+bool recordMatches(const GameRecordHeader &header, const unsigned char *events, const Rules &rules, int numPlayers, const GameResult &result);
+bool loadRecordFiles(const string &path, vector <RecordFile*> &files);
+int replayRecord(const SimulationOptions &options);
 void trim(string &str);
 void getPositiveNum(int &response, string request);
 bool getYesOrNoResponse(bool &response, string request);
 
-int main() {
-	// for random number generation
-	srand((unsigned int)time(NULL));
+int main(int argc, char *argv[]) {
+	// play games between AIs with no console I/O (ex. --simulate 1000000 --players 4 --threads 8)
+	SimulationOptions options;
+	options.threads = max(1, (int)thread::hardware_concurrency());
+	options.firstSeed = random_device()() ^ (unsigned long long)time(NULL);
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--simulate" && hasValue) { options.games = atoll(argv[++i]); }
+		else if (arg == "--players" && hasValue) { options.players = atoi(argv[++i]); }
+		else if (arg == "--threads" && hasValue) { options.threads = max(1, atoi(argv[++i])); }
+		else if (arg == "--seed" && hasValue) { options.firstSeed = strtoull(argv[++i], NULL, 10); }
+		else if (arg == "--scaling") { options.scaling = true; }
+		else if (arg == "--sweep") { options.sweep = true; }
+		else if (arg == "--runtime-rules") { options.runtimeRules = true; }
+		else if (arg == "--compare-engines") { options.compareEngines = true; }
+		else if (arg == "--search" && hasValue) { options.searchPlayers = atoi(argv[++i]); }
+		else if (arg == "--playouts" && hasValue) { options.playouts = max(1, atoi(argv[++i])); }
+		else if (arg == "--search-threads" && hasValue) { options.searchThreads = max(1, atoi(argv[++i])); }
+		else if (arg == "--budget" && hasValue) { options.budget = max(0.0, atof(argv[++i])); }
+		else if (arg == "--table" && hasValue) { options.table = argv[++i]; }
+		else if (arg == "--record" && hasValue) { options.record = argv[++i]; }
+		else if (arg == "--analyze" && hasValue) { options.analyze = argv[++i]; }
+		else if (arg == "--replay" && hasValue) { options.replay = argv[++i]; }
+		else if (arg == "--game" && hasValue) { options.replayGame = strtoull(argv[++i], NULL, 10); }
+		else if (arg == "--turn" && hasValue) { options.replayTurn = max(0, atoi(argv[++i])); }
+		else if (arg == "--gen-table" && hasValue) { options.genTable = argv[++i]; }
+		/* BENCHMARKS */
+		else if (arg == "--bench") { options.bench = true; }
+		else if (arg == "--bench-out" && hasValue) { options.benchOut = argv[++i]; }
+		else if (arg == "--baseline" && hasValue) { options.baseline = argv[++i]; }
+		else if (arg == "--threshold" && hasValue) { options.threshold = atof(argv[++i]); }
+		else if (arg == "--self-test") { options.selfTest = true; }
+		/* RULES */
+		else if (arg == "--cards" && hasValue) { options.rules.cardsAtStart = atoi(argv[++i]); }
+		else if (arg == "--yaniv" && hasValue) { options.rules.minToCallYaniv = atoi(argv[++i]); }
+		else if (arg == "--penalty" && hasValue) { options.rules.assafPenalty = atoi(argv[++i]); }
+		else if (arg == "--extra-penalty" && hasValue) { options.rules.extraAssafPenalties = atoi(argv[++i]); }
+		else if (arg == "--limit" && hasValue) { options.rules.pointsLimit = atoi(argv[++i]); }
+		else if (arg == "--no-slapdown") { options.rules.canSlapdown = false; }
+		else if (arg == "--no-joker-swap") { options.rules.canSwapJoker = false; }
+		else if (arg == "--no-middle-take") { options.rules.canTakeFromMiddleOfSet = false; }
+		else if (arg == "--deduct-50") { options.rules.reductionIsHalf = false; }
+		else {
+			cout << "Usage: " << argv[0] << " [--simulate GAMES] [--players " << MIN_PLAYERS << "-" << MAX_PLAYERS << "] [--threads N] [--seed SEED] [--scaling] [--sweep] [--runtime-rules] [--compare-engines]" << endl;
+			cout << "       [--search AIS] [--playouts N] [--search-threads N] [--budget MS] [--table FILE] [--record FILE]" << endl;
+			cout << "       [--cards N] [--yaniv POINTS] [--penalty POINTS] [--extra-penalty POINTS] [--limit POINTS]" << endl;
+			cout << "       [--no-slapdown] [--no-joker-swap] [--no-middle-take] [--deduct-50]" << endl;
+			cout << "       " << argv[0] << " --bench [--bench-out FILE] [--baseline FILE] [--threshold PERCENT]" << endl;
+			cout << "       " << argv[0] << " --self-test [--players " << MIN_PLAYERS << "-" << MAX_PLAYERS << "]" << endl;
+			cout << "       " << argv[0] << " --gen-table FILE [--yaniv POINTS]" << endl;
+			cout << "       " << argv[0] << " --analyze FILE [--threads N]" << endl;
+			cout << "       " << argv[0] << " --replay FILE --game SEED --turn N [--search AIS] [--playouts N] [rule variations]" << endl;
+			return 1;
+		}
+	}
+	if (options.bench) {
+		return runBenchmarks(options);
+	}
+	if (options.selfTest) {
+		return runSelfTest(options);
+	}
+	if (!options.genTable.empty()) {
+		return generateTable(options);
+	}
+	if (!options.analyze.empty()) {
+		return analyzeRecords(options);
+	}
+	// use the best discards worked out ahead of time if they were made for these rules, otherwise work them out every turn
+	DiscardTable table;
+	if (table.load(options.table)) {
+		if (table.minToCallYaniv == options.rules.minToCallYaniv) {
+			options.discardTable = &table;
+		}
+		else {
+			cerr << options.table << " was made for calling Yaniv at " << table.minToCallYaniv << " points, not using it." << endl;
+		}
+	}
+	else if (ifstream(options.table)) {
+		cerr << options.table << " isn't a discard table for this version, not using it (make a new one with --gen-table)." << endl;
+	}
+	if (!options.replay.empty()) {
+		return replayRecord(options);
+	}
+	if (options.games > 0) {
+		if (options.compareEngines) { return compareEngines(options); }
+		return (options.sweep ? runSweep(options) : runSimulation(options));
+	}
 
 	Yaniv game;
+	game.discardTable = options.discardTable;
+	// for random number generation
+	game.rng.seed(random_device()() ^ (unsigned long long)time(NULL));
+	game.aiRng.seed(random_device()() ^ (unsigned long long)time(NULL));
 
 	clearScreen();
 	cout << "Welcome to Yaniv!" << endl;
@@ -153,6 +1298,7 @@ int main() {
 int Yaniv::playGame() {
 	int winner;
 	char buffer[100];
+	int turnsInRound = 0;
 	while (true) {
 		int historyLines = history.size();
 		while (historyLines >= remainingPlayers) {
@@ -163,45 +1309,25 @@ int Yaniv::playGame() {
 		if (!activePlayer->stillPlaying) { // if active player is out, skip to next player
 			changeTurn();
 		}
+		else if (turnsInRound == MAX_TURNS_PER_ROUND) { // redeal if no one will call (ex. only AIs are left)
+			clearScreen();
+			cout << "No one called Yaniv in " << MAX_TURNS_PER_ROUND << " turns, so the cards are dealt again." << endl;
+			cout << "Press enter to start next round...";
+			cin.getline(buffer, 100);
+			turnsInRound = 0;
+			resetRound(currentPlayer);
+		}
 		else if (activePlayer->AI) { // if AI and still playing
+			++turnsInRound;
 			// clear screen print player number and wait for enter key
 			clearScreen();
 			cout << activePlayer->name << "'s turn." << endl;
 			sortCards(activePlayer->hand);
 
-			// figure out average value of cards not in AI's hand or discard pile
-			vector <string> unknowns = deck;
-			for (size_t i = 0; i < players.size(); i++) {
-				if (i != currentPlayer)
-					unknowns.insert(unknowns.end(), players[i].hand.begin(), players[i].hand.end());
-			}
-			int sumOfUnknowns = 0;
-			for (size_t i = 0; i < unknowns.size(); i++)
-				sumOfUnknowns += pointsForCard(unknowns[i]);
-			float averageOfUnknowns = (float) sumOfUnknowns / unknowns.size();
-
-			// if MIN_TO_CALL_YANIV or under, call Yaniv unless suspects assaf//
-			int points = countPoints(activePlayer->hand);
-			bool suspectsAssaf = false;
-			// check if has Yaniv
-			if (points <= MIN_TO_CALL_YANIV) {
-				// if the publicly drawn cards of a player add up to less than what AI has, suspect Assaf
-				// if player has cards AI does not know the value of, multiply the number by half the average of unseen cards
-				for (size_t i = 0; i < players.size(); i++) {
-					if (i != currentPlayer) {
-						// number of points player has in hand from publicly drawn cards
-						int publiclyDrawnPts = countPoints(players[i].cardsDrawnPublicly);
-						// get number of cards player holds that are not publicly drawn (and values are unknown to AI)
-						int numUnknownCards = players[i].hand.size() - players[i].cardsDrawnPublicly.size();
-						// if estimated player's points are less than or equal to AI's points, suspect Assaf and don't call Yaniv
-						if (publiclyDrawnPts + (numUnknownCards * (averageOfUnknowns / 2)) <= points) {
-							suspectsAssaf = true;
-							break;
-						}
-					}
-				}
-			}
-			if (points <= MIN_TO_CALL_YANIV && !suspectsAssaf) {
+			// if minimum to call Yaniv or under, call Yaniv unless suspects assaf
+			int points = activePlayer->handPoints;
+			Move move;
+			if (aiDecide(*activePlayer, points, move)) {
 				clearScreen();
 				cout << activePlayer->name << " called Yaniv." << endl;
 				winner = callYaniv(*activePlayer, points);
@@ -211,120 +1337,43 @@ int Yaniv::playGame() {
 				}
 				cout << "Press enter to start next round...";
 				cin.getline(buffer, 100);
+				turnsInRound = 0;
 				resetRound(winner);
 			}
 			else {
-				string slapdown = "";
-				// check if taking L or R will result in straight or set //
-				// if yes, find best discard of non-saved cards (highest point straight/set) and take face up card //
+				Card drawnCard;
+				Card slapdown;
+				bool validTurn = aiTakeTurn(*activePlayer, move, drawnCard, slapdown);
+
+				// discard best of held cards //
 				string discards = "";
-				string drawnCard = "";
-				vector <string> bestOfHand = getBestDiscard(activePlayer->hand);
-				vector <string> bestWithTaking = getBestDiscard(activePlayer->hand, nextAvailableToTake);
-				// if taking makes a difference and taking allows playing more than 1 card (or AI can take a Joker)
-				vector <string> bestOfHandCards(bestOfHand.cbegin() + 1, bestOfHand.cend());
-				vector <string>	bestWithTakingCards(bestWithTaking.cbegin() + 1, bestWithTaking.cend());
-				if ((bestOfHandCards != bestWithTakingCards && bestWithTakingCards.size() > 1) || bestWithTaking.front() == "J"){
-					// get cards not used in combination with face up card
-					vector <string> cardsNotSaved = activePlayer->hand;
-					for (size_t i = 0; i < bestWithTaking.size(); i++) {
-						if (count(cardsNotSaved.begin(), cardsNotSaved.end(), bestWithTaking[i])) {
-							cardsNotSaved.erase(find(cardsNotSaved.begin(), cardsNotSaved.end(), bestWithTaking[i]));
-						}
-					}
-					// if AI has cards to save
-					if (cardsNotSaved.size()) {
-						bestOfHand = getBestDiscard(cardsNotSaved);
-					}
-
-					drawnCard = bestWithTaking.front();
-					discardPile.erase(find(discardPile.begin(), discardPile.end(), bestWithTaking.front()));
-					activePlayer->hand.push_back(bestWithTaking.front());
-					activePlayer->cardsDrawnPublicly.push_back(activePlayer->hand.back());
-					sortCards(activePlayer->hand);
-				}
-				else {
-					// check if drawing an available card will help AI on next turn
-					bool drawnCardAlready = false;
-					vector <string> savedCards = activePlayer->hand;
-					for (size_t i = 1; i < bestOfHand.size(); i++)	{
-						savedCards.erase(find(savedCards.begin(),savedCards.end(), bestOfHand[i]));
-					}
-					// if AI has cards to save
-					if (savedCards.size()) {
-						vector <string> bestOfSaved = getBestDiscard(savedCards);
-						vector <string> bestOfSavedWithTaking = getBestDiscard(savedCards, nextAvailableToTake, false);
-						vector <string> bestOfSavedCards(bestOfSaved.cbegin() + 1, bestOfSaved.cend());
-						vector <string>	bestOfSavedWithTakingCards(bestOfSavedWithTaking.cbegin() + 1, bestOfSavedWithTaking.cend());
-						// if taking makes a difference and taking allows playing more than 1 card (or AI can take a Joker)
-						if ((bestOfSavedCards != bestOfSavedWithTakingCards && bestOfSavedWithTakingCards.size() > 1) || bestOfSavedWithTaking.front() == "J") {
-							// draw card from available
-							drawnCard = bestOfSavedWithTaking.front();
-							discardPile.erase(find(discardPile.begin(), discardPile.end(), bestOfSavedWithTaking.front()));
-							activePlayer->hand.push_back(bestOfSavedWithTaking.front());
-							activePlayer->cardsDrawnPublicly.push_back(activePlayer->hand.back());
-							sortCards(activePlayer->hand);
-							drawnCardAlready = true;
-						}
-					}
-
-					if (!drawnCardAlready) {
-						// take from draw pile if:
-						// EITHER average of unknowns is less than the lower of available cards (left card is always smaller or equal to right card)
-						// OR your hand is very low, gamble for a card lower than available
-						int leftoverPts = countPoints(activePlayer->hand) - countPoints(bestOfHand);
-						if ((averageOfUnknowns < pointsForCard(nextAvailableToTake[0])) ||
-							(leftoverPts <= 7 && pointsForCard(nextAvailableToTake[0]) >= (8 - leftoverPts))) {
-							// take from draw pile
-							dealCards(*activePlayer);
-							if (CAN_SLAPDOWN) {
-								// check for slapdown
-								drawnCard = activePlayer->hand.back();
-								if (getValue(drawnCard) == getValue(bestOfHand[1]) && getValue(drawnCard) == getValue(bestOfHand.back()) && drawnCard != "J") {
-									slapdown = drawnCard;
-								}
-							}
-							// hide card from other players
-							drawnCard = "from the draw pile";
-						}
-						// if not, take smaller of face up cards
-						else {
-							drawnCard = nextAvailableToTake[0];
-							discardPile.erase(find(discardPile.begin(), discardPile.end(), nextAvailableToTake[0]));
-							activePlayer->hand.push_back(nextAvailableToTake[0]); // take from discard
-							activePlayer->cardsDrawnPublicly.push_back(activePlayer->hand.back());
-						}
-					}
-				}
-				// discard best of held cards //
 				cout << activePlayer->name << " discarded";
-				for (size_t i = 1; i < bestOfHand.size(); i++) {
-					cout << " " + bestOfHand[i];
-					discards += bestOfHand[i] + " ";
+				for (size_t i = 0; i < move.discards.size(); i++) {
+					cout << " " + cardToString(move.discards[i]);
+					discards += cardToString(move.discards[i]) + " ";
 				}
 				trim(discards);
-				if (!checkDiscards((*activePlayer), discards)) {
+				if (!validTurn) {
 					cout << "ERROR IN DISCARD";
 				}
 				cout << "." << endl;
 
-				cout << activePlayer->name << " picked up " << drawnCard << "." << endl;
+				// hide card from other players if taken from the draw pile
+				string picked = (move.source == DRAW_PILE ? "from the draw pile" : cardToString(drawnCard));
+				cout << activePlayer->name << " picked up " << picked << "." << endl;
 
-				if (slapdown != "") {
-					cout << "The " << slapdown << " that was drawn was slapped down!" << endl;
-					activePlayer->hand.pop_back(); // remove last card from hand
-					discardPile.push_back(slapdown); // add to discard pile
-					nextAvailableToTake.push_back(slapdown); // add to end of next available to take
+				if (slapdown != NO_CARD) {
+					cout << "The " << cardToString(slapdown) << " that was drawn was slapped down!" << endl;
 				}
 
 				// put discarded cards into availableToTake for next player
 				availableToTake = nextAvailableToTake;
 
 				string turn;
-				if (slapdown.length())
-					turn = activePlayer->name + " discarded " + discards + " " + slapdown + " (" + slapdown + " was slapped down)" + ", and now has " + to_string(activePlayer->hand.size()) + (activePlayer->hand.size() == 1 ? " card." : " cards.");
+				if (slapdown != NO_CARD)
+					turn = activePlayer->name + " discarded " + discards + " " + cardToString(slapdown) + " (" + cardToString(slapdown) + " was slapped down)" + ", and now has " + to_string(activePlayer->hand.size()) + (activePlayer->hand.size() == 1 ? " card." : " cards.");
 				else
-					turn = activePlayer->name + " discarded " + discards + ", picked " + drawnCard + ", and now has " + to_string(activePlayer->hand.size()) + (activePlayer->hand.size() == 1 ? " card." : " cards.");
+					turn = activePlayer->name + " discarded " + discards + ", picked " + picked + ", and now has " + to_string(activePlayer->hand.size()) + (activePlayer->hand.size() == 1 ? " card." : " cards.");
 
 				history.push_back(turn);
 
@@ -334,6 +1383,7 @@ int Yaniv::playGame() {
 			}
 		}
 		else { // if Human and still playing
+			++turnsInRound;
 
 			// clear screen
 			clearScreen();
@@ -363,8 +1413,8 @@ int Yaniv::playGame() {
 
 			// check if can call Yaniv
 			bool calledYaniv = false;
-			int points = countPoints(activePlayer->hand);
-			if (points <= MIN_TO_CALL_YANIV) {
+			int points = activePlayer->handPoints;
+			if (points <= rules.minToCallYaniv) {
 				bool response;
 				if (getYesOrNoResponse(response, "Do you want to call Yaniv? (Y/N): ")) {
 					calledYaniv = true;
@@ -382,16 +1432,14 @@ int Yaniv::playGame() {
 				}
 				cout << "Press enter to start next round...";
 				cin.getline(buffer, 100);
+				turnsInRound = 0;
 				resetRound(winner);
 			}
 			else {
 				bool undo = false;
 				do {
-					// backup in case of undo
-					vector <string> nextAvailableToTakeCopy = nextAvailableToTake;
-					vector <string> discardPileCopy = discardPile;
-					vector <string> historyCopy = history;
-					Player playerCopy = *activePlayer;
+					// nothing changes until the whole move is entered, so undo only asks again
+					Move move;
 
 					// discard cards
 					string discards;
@@ -400,9 +1448,14 @@ int Yaniv::playGame() {
 						getline(cin, discards);
 						trim(discards);
 						transform(discards.begin(), discards.end(), discards.begin(), ::toupper);
-						if (checkDiscards((*activePlayer), discards)) {
+						if (parseDiscards((*activePlayer), discards, move.discards)) {
+							vector <Card> keptCards;
+							for (size_t i = 0; i < activePlayer->hand.size(); i++) {
+								if (!count(move.discards.begin(), move.discards.end(), activePlayer->hand[i]))
+									keptCards.push_back(activePlayer->hand[i]);
+							}
 							cout << "Your hand: ";
-							printVector(activePlayer->hand);
+							printVector(keptCards);
 							break;
 						}
 					}
@@ -413,17 +1466,13 @@ int Yaniv::playGame() {
 
 					// choose card to draw
 					string draw;
-					string slapdown;
+					Card slapdown = NO_CARD;
 					while (true) {
 						cout << "Which card do you want to draw (type 'D' for draw pile)? ";
 						getline(cin, draw);
 						trim(draw);
 						transform(draw.begin(), draw.end(), draw.begin(), ::toupper);
 						if (draw == "UNDO") {
-							nextAvailableToTake = nextAvailableToTakeCopy;
-							discardPile = discardPileCopy;
-							history = historyCopy;
-							*activePlayer = playerCopy;
 							cout << "Your hand: ";
 							printVector(activePlayer->hand);
 							cout << "Top of discard pile: ";
@@ -431,21 +1480,38 @@ int Yaniv::playGame() {
 							undo = true;
 							break;
 						}
-						if (checkDraw(players[currentPlayer], draw, slapdown)) {
+						if (parseDraw(draw, move)) {
 							undo = false;
 							break;
 						}
 					}
 
 					if (!undo) {
+						Card drawnCard = applyMove(*activePlayer, move, slapdown);
+						if (move.source == DRAW_PILE && drawnCard != NO_CARD && rules.canSlapdown && matchesDiscards(drawnCard)) {
+							// ask if user wants to do slapdown
+							bool response;
+							string request = "Do you want to slap down the " + cardToString(drawnCard) + " you drew? (Y/N): ";
+							if (getYesOrNoResponse(response, request)) {
+								cout << "The " << cardToString(drawnCard) << " you drew was slapped down!" << endl;
+								slapdown = drawnCard;
+								slapDown(*activePlayer, drawnCard);
+							}
+						}
+
+						// sort and display hand
+						sortCards(activePlayer->hand);
+						cout << "Your hand: ";
+						printVector(activePlayer->hand);
+
 						// put discarded cards into availableToTake for next player
 						availableToTake = nextAvailableToTake;
 
 						string turn;
-						if (slapdown.length())
-							turn = activePlayer->name + " discarded " + discards + " " + slapdown + " (" + slapdown + " was slapped down)" + ", and now has " + to_string(activePlayer->hand.size()) + (activePlayer->hand.size() == 1 ? " card." : " cards.");
+						if (slapdown != NO_CARD)
+							turn = activePlayer->name + " discarded " + discards + " " + cardToString(slapdown) + " (" + cardToString(slapdown) + " was slapped down)" + ", and now has " + to_string(activePlayer->hand.size()) + (activePlayer->hand.size() == 1 ? " card." : " cards.");
 						else 
-							turn = activePlayer->name + " discarded " + discards + ", picked " + (draw == "D" ? "from the draw pile" : draw) + ", and now has " + to_string(activePlayer->hand.size()) + (activePlayer->hand.size() == 1 ? " card." : " cards.");
+							turn = activePlayer->name + " discarded " + discards + ", picked " + (move.source == DRAW_PILE ? "from the draw pile" : cardToString(move.take)) + ", and now has " + to_string(activePlayer->hand.size()) + (activePlayer->hand.size() == 1 ? " card." : " cards.");
 
 						history.push_back(turn);
 					}
@@ -461,689 +1527,3215 @@ int Yaniv::playGame() {
 	}
 }
 
-void Yaniv::makePlayers() {
-	bool response;
-
-	// Set up rule variations
-	if (!getYesOrNoResponse(response, "Do you want to play with the default rules? (Y/N): ")) {
-		/* NUMBERS */
-		cout << "How many cards should each player be dealt? (Default: 5) " << endl;
-		getPositiveNum(CARDS_AT_START, "Enter a positive number of cards: "); // cards each player is dealt
-		cout << "What is the most points with which one can call Yaniv? (Default: 7) " << endl;
-		getPositiveNum(MIN_TO_CALL_YANIV, "Enter a positive number of points: "); // minimum points to call Yaniv
-		cout << "How many points does a player who is Assaf-ed receive as a penalty? (Default: 30) " << endl;
-		getPositiveNum(ASSAF_PENALTY, "Enter a positive number of points: "); // penalty for being Assaf-ed
-		cout << "How many extra points are given for each additional player who can call Assaf? (Default: 0) " << endl;
-		getPositiveNum(EXTRA_ASSAF_PENALTIES, "Enter a positive number of points: "); // additional penalties for each additional player who can Assaf you (usually 20 pts when applied)
-		cout << "How many points can a player receive before being eliminated? (Default: 200) " << endl;
-		getPositiveNum(POINTS_LIMIT, "Enter a positive number of points: "); // Score that eliminates players
-
-		/* RULE VARIATIONS */
-		cout << "If a card of the same type that was played is drawn, can it be slapped down? (Default: Y) " << endl;
-		getYesOrNoResponse(CAN_SLAPDOWN, "Enter 'Y' to allow slap-downs or 'N' to disallow: "); // if you draw from the draw pile the same type of card you just played, you can slap down your drawn card
-		cout << "If a player plays a series with a joker, can the next player swap the card it substitutes for the joker? (Default: Y) " << endl;
-		getYesOrNoResponse(CAN_SWAP_JOKER, "Enter 'Y' to allow swapping for jokers or 'N' to disallow: "); // if next player has the card that goes in place of the joker, they can swap for it
-		cout << "If a player plays 3 or 4-of-a-kind is the next player allowed to take any card from the set they want? (Default: Y) " << endl;
-		getYesOrNoResponse(CAN_TAKE_FROM_MIDDLE_OF_SET, "Enter 'Y' to allow taking from middle of multiples sets or 'N' to disallow: "); // if 3-of-a-kind or 4-of-a-kind played, the next player may take any card from the set
-		cout << "When a player lands on a multiple of 50, are half of the points removed? (Default: Y) " << endl;
-		getYesOrNoResponse(REDUCTION_IS_HALF, "Enter 'Y' to remove HALF or 'N' to remove 50 POINTS on multiples of 50: "); // 50% reduction as opposed a 50-point reduction
+// plays the game with its rule variations compiled in, or looked up as it goes if runtimeChecked
+GameResult Yaniv::simulateGame(bool runtimeChecked) {
+	typedef GameResult (Yaniv::*Engine)();
+	static const Engine ENGINES[16] = {
+		&Yaniv::simulateGameWith<FixedRules<false, false, false, false> >, &Yaniv::simulateGameWith<FixedRules<false, false, false, true> >,
+		&Yaniv::simulateGameWith<FixedRules<false, false, true, false> >, &Yaniv::simulateGameWith<FixedRules<false, false, true, true> >,
+		&Yaniv::simulateGameWith<FixedRules<false, true, false, false> >, &Yaniv::simulateGameWith<FixedRules<false, true, false, true> >,
+		&Yaniv::simulateGameWith<FixedRules<false, true, true, false> >, &Yaniv::simulateGameWith<FixedRules<false, true, true, true> >,
+		&Yaniv::simulateGameWith<FixedRules<true, false, false, false> >, &Yaniv::simulateGameWith<FixedRules<true, false, false, true> >,
+		&Yaniv::simulateGameWith<FixedRules<true, false, true, false> >, &Yaniv::simulateGameWith<FixedRules<true, false, true, true> >,
+		&Yaniv::simulateGameWith<FixedRules<true, true, false, false> >, &Yaniv::simulateGameWith<FixedRules<true, true, false, true> >,
+		&Yaniv::simulateGameWith<FixedRules<true, true, true, false> >, &Yaniv::simulateGameWith<FixedRules<true, true, true, true> >
+	};
+	if (runtimeChecked) {
+		return simulateGameWith<RuntimeRules>();
 	}
+	return (this->*ENGINES[rules.canSlapdown << 3 | rules.canSwapJoker << 2 | rules.canTakeFromMiddleOfSet << 1 | rules.reductionIsHalf])();
+}
 
-	int numAI;
+template <class R>
+GameResult Yaniv::simulateGameWith() {
+	GameResult result;
+	result.seed = seed;
+	int turnsInRound = 0;
+	RoundResult round;
 	while (true) {
-		cout << "How many humans? ";
-		cin >> numHuman;
-		numPlayers = numHuman;
-		if (cin.fail() || numPlayers < 0 || numPlayers > MAX_PLAYERS) {
-			cout << "The number of players must be between " << MIN_PLAYERS << " and " << MAX_PLAYERS << "." << endl;
-			cin.clear();
-			cin.ignore(numeric_limits<streamsize>::max(), '\n');
-		}
-		else {
-			cin.ignore();
-			break;
+		if (simulateTurn<R>(result, turnsInRound)) {
+			Player &caller = players[currentPlayer];
+			int points = caller.handPoints;
+			scoreRound<R>(caller, points, round);
+			if (finishRound(result, round, points, turnsInRound)) {
+				return result;
+			}
 		}
 	}
+}
+
+// plays the next player's turn, true if they called Yaniv (the round is left for the caller to score)
+template <class R>
+bool Yaniv::simulateTurn(GameResult &result, int &turnsInRound) {
+	startTurn(result, turnsInRound);
+	Player &activePlayer = players[currentPlayer];
+	if (recorder && turnsPlayed && turnsPlayed % RECORD_SNAPSHOT_TURNS == 0) {
+		recordSnapshot();
+	}
+	++result.turns;
+	++turnsInRound;
+	// search AIs are timed so their latency can be reported, the heuristic takes microseconds
+	chrono::steady_clock::time_point decisionStart;
+	if (activePlayer.playouts > 0) { decisionStart = chrono::steady_clock::now(); }
+	bool callsYaniv = decideTurn<R>(activePlayer, simulatedMove);
+	if (activePlayer.playouts > 0) { result.decisionMs.push_back(chrono::duration<float, milli>(chrono::steady_clock::now() - decisionStart).count()); }
+	if (callsYaniv) {
+		return true;
+	}
+	Card drawnCard, slapdown;
+	if (aiTakeTurn<R>(activePlayer, simulatedMove, drawnCard, slapdown) && recorder) {
+		recordTurn(simulatedMove, drawnCard, slapdown);
+	}
+	// put discarded cards into availableToTake for next player
+	availableToTake = nextAvailableToTake;
+	changeTurn();
+	return false;
+}
+
+// gets the next turn ready to be decided: players who are out are skipped and a round the AIs are stuck in is redealt
+void Yaniv::startTurn(GameResult &result, int &turnsInRound) {
 	while (true) {
-		cout << "How many AIs? ";
-		cin >> numAI;
-		numPlayers = numHuman + numAI;
-		if (cin.fail() || numPlayers < MIN_PLAYERS || numPlayers > MAX_PLAYERS) {
-			cout << "The number of players must be between " << MIN_PLAYERS << " and " << MAX_PLAYERS << "." << endl;
-			cin.clear();
-			cin.ignore(numeric_limits<streamsize>::max(), '\n');
+		if (!players[currentPlayer].stillPlaying) { // if active player is out, skip to next player
+			changeTurn();
+			continue;
 		}
-		else {
-			cin.ignore();
-			break;
+		if (turnsInRound == MAX_TURNS_PER_ROUND) { // redeal if AIs are stuck
+			++result.stalledRounds;
+			turnsInRound = 0;
+			resetRound(currentPlayer);
+			continue;
 		}
+		return;
 	}
+}
 
-	remainingPlayers = numPlayers;
-
-	// shuffle cards for extra randomness
-	std::random_shuffle(deck.begin(), deck.end());
+// the active player's decision at the start of their turn, made with the same random numbers every time the game reaches this turn
+template <class R>
+bool Yaniv::decideTurn(Player &activePlayer, Move &move) {
+	sortCards(activePlayer.hand);
+	++turnsPlayed;
+	aiRng.seed(seed ^ (unsigned long long)turnsPlayed << 40);
+	return aiDecide<R>(activePlayer, activePlayer.handPoints, move);
+}
 
-	// make players array and deal 5 cards to each
-	for (int i = 0; i < numPlayers; i++) {
-		// add player to array
-		Player player;
-		players.push_back(player);
+// records a scored round and deals the next one, true if the game is over
+bool Yaniv::finishRound(GameResult &result, const RoundResult &round, int points, int &turnsInRound) {
+	++result.rounds;
+	if (round.assafers.size()) {
+		AssafEvent assaf;
+		assaf.round = result.rounds;
+		assaf.caller = round.caller;
+		assaf.callerPoints = points;
+		assaf.assafers = round.assafers;
+		result.assafs.push_back(assaf);
+	}
+	vector <int> scores;
+	for (size_t i = 0; i < players.size(); i++)
+		scores.push_back(players[i].score);
+	result.roundScores.push_back(scores);
+	if (recorder) {
+		recordRound(round, points);
+	}
+	if (remainingPlayers == 1) {
+		result.winner = round.nextPlayer;
+		if (recorder) {
+			endRecord(result.winner);
+		}
+		return true;
+	}
+	turnsInRound = 0;
+	resetRound(round.nextPlayer);
+	return false;
+}
 
-		// set player name
-		while (true) {
-			// request name for player
-			string name;
-			cout << "Enter name for Player " << (i + 1);
-			if (i >= numHuman) { // set AI status of player to true
-				players[i].AI = true;
-				cout << " [AI]";
-			}
-			cout << ": ";
-			getline(cin, name);
-			trim(name);
+void Yaniv::startGame(unsigned long long gameSeed) {
+	// everything random in a game comes from its seed, including who goes first
+	seed = gameSeed;
+	rng.seed(gameSeed);
+	turnsPlayed = 0;
+	if (recorder) {
+		beginRecord();
+	}
+	resetGame(rng.below(numPlayers));
+}
 
-			// check if name is valid (not taken and not blank)
-			bool nameTaken = false;
-			for (size_t j = 0; j < players.size() - 1; j++) {
-				if (players[j].name == name) {
-					nameTaken = true;
-					break;
-				}
-			}
-			if (nameTaken) {
-				cout << "That name is already being used." << endl;
-			}
-			else if (name.length() == 0) {
-				cout << "Name cannot be blank." << endl;
-			}
-			else {
-				players[i].name = name;
-				break;
-			}
-		}
+// game records: a header with the seed and rules, then a few bytes per event (see RecordEvent)
+void Yaniv::beginRecord() {
+	GameRecordHeader header;
+	header.seed = seed;
+	header.assafPenalty = rules.assafPenalty;
+	header.extraAssafPenalties = rules.extraAssafPenalties;
+	header.pointsLimit = rules.pointsLimit;
+	header.players = numPlayers;
+	header.cardsAtStart = rules.cardsAtStart;
+	header.minToCallYaniv = rules.minToCallYaniv;
+	header.variations = rules.canSlapdown << 3 | rules.canSwapJoker << 2 | rules.canTakeFromMiddleOfSet << 1 | rules.reductionIsHalf;
+	assert(recordFits(rules));
+	record.resize(sizeof(header));
+	memcpy(record.data(), &header, sizeof(header));
+}
 
-		// deal and sort cards
-		dealCards(players[i], CARDS_AT_START);
-		sortCards(players[i].hand);
+void Yaniv::recordDeal() {
+	record.push_back(EVENT_DEAL | currentPlayer);
+	for (size_t i = 0; i < players.size(); i++) {
+		record.push_back(players[i].hand.size());
+		record.insert(record.end(), players[i].hand.begin(), players[i].hand.end());
 	}
+	record.push_back(availableToTake.back());
+}
 
-	// make a card available for first player to take
-	int cardNum = rand() % deck.size();
-	discardPile.push_back(deck[cardNum]);
-	availableToTake.push_back(deck[cardNum]);
-	nextAvailableToTake = availableToTake;
-	deck.erase(deck.begin() + cardNum);
+void Yaniv::recordTurn(const Move &move, Card drawnCard, Card slapdown) {
+	int flags = (move.source == DISCARD_PILE ? TOOK_DISCARD : 0) | (slapdown != NO_CARD ? SLAPPED_DOWN : 0) | (move.jokerSwap ? SWAPPED_JOKER : 0);
+	record.push_back(EVENT_TURN | flags);
+	assert(move.discards.size() < 32);
+	record.push_back(currentPlayer << 5 | move.discards.size());
+	record.insert(record.end(), move.discards.begin(), move.discards.end());
+	record.push_back(drawnCard);
 }
 
-void Yaniv::dealCards(Player &player, int numCards) {
-	if (deck.size() <= 0) {
-		// move discard pile back into deck, leave available cards in discard pile
-		int cardsToTransfer = discardPile.size() - nextAvailableToTake.size();
-		for (int i = 0; i < cardsToTransfer; i++) {
-			deck.push_back(discardPile[0]);
-			discardPile.erase(discardPile.begin());
-		}
+void Yaniv::recordRound(const RoundResult &round, int points) {
+	int assafers = 0, reduced = 0, eliminated = 0;
+	for (size_t i = 0; i < round.assafers.size(); i++)
+		assafers |= 1 << round.assafers[i];
+	for (size_t i = 0; i < players.size(); i++) {
+		reduced |= round.scoreReduced[i] << i;
+		eliminated |= round.eliminated[i] << i;
 	}
-	for (int i = 0; i < numCards; i++) {
-		int cardNum = rand() % deck.size();
-		player.hand.push_back(deck[cardNum]);
-		deck.erase(deck.begin() + cardNum); // remove card from deck
+	record.push_back(EVENT_YANIV | round.caller);
+	assert(points >= 0 && points <= 0xFF); // at most minToCallYaniv, which recordFits checked
+	record.push_back(points);
+	record.push_back(players[round.caller].hand.size());
+	record.push_back(assafers);
+	record.push_back(EVENT_SCORES | round.nextPlayer);
+	record.push_back(reduced);
+	record.push_back(eliminated);
+	for (size_t i = 0; i < players.size(); i++) {
+		assert(players[i].score >= 0 && players[i].score <= 0xFFFF);
+		record.push_back(players[i].score & 0xFF);
+		record.push_back(players[i].score >> 8);
 	}
 }
 
-void Yaniv::printVector(vector<string> v) {
-	for (size_t i = 0; i < v.size(); i++) {
-		cout << v[i] << " ";
+void Yaniv::endRecord(int winner) {
+	record.push_back(EVENT_END | winner);
+	unsigned bytes = record.size() - sizeof(GameRecordHeader);
+	memcpy(record.data() + offsetof(GameRecordHeader, bytes), &bytes, sizeof(bytes));
+	recorder->write(record);
+}
+
+// cards as their count then the cards
+void appendCards(vector <unsigned char> &record, const vector<Card> &cards) {
+	record.push_back(cards.size());
+	record.insert(record.end(), cards.begin(), cards.end());
+}
+
+const unsigned char *readCards(const unsigned char *data, vector<Card> &cards) {
+	cards.assign(data + 1, data + 1 + *data);
+	return data + 1 + *data;
+}
+
+// everything a replay needs to carry on from the start of this turn: the turn, the cards' random numbers, who plays next, the face-up cards taken in a row and where every card is,
+// every player's score, hand, cards drawn publicly and the cards they haven't seen (decisions are seeded from the turn so their random numbers aren't kept)
+void Yaniv::recordSnapshot() {
+	record.push_back(EVENT_SNAPSHOT);
+	size_t start = record.size();
+	record.resize(start + 2 + sizeof(turnsPlayed) + sizeof(rng.state));
+	memcpy(&record[start + 2], &turnsPlayed, sizeof(turnsPlayed));
+	memcpy(&record[start + 2 + sizeof(turnsPlayed)], rng.state, sizeof(rng.state));
+	record.push_back(currentPlayer);
+	record.push_back(remainingPlayers);
+	record.push_back(faceUpTakes);
+	appendCards(record, deck);
+	appendCards(record, discardPile);
+	appendCards(record, availableToTake); // the same as nextAvailableToTake between turns
+	for (size_t i = 0; i < players.size(); i++) {
+		assert(players[i].score >= 0 && players[i].score <= 0xFFFF);
+		record.push_back(players[i].score & 0xFF);
+		record.push_back(players[i].score >> 8);
+		record.push_back(players[i].stillPlaying);
+		appendCards(record, players[i].hand);
+		appendCards(record, players[i].cardsDrawnPublicly);
+		record.resize(record.size() + sizeof(CardSet));
+		memcpy(&record[record.size() - sizeof(CardSet)], &players[i].knowledge.unseen, sizeof(CardSet));
 	}
-	cout << endl;
+	size_t length = record.size() - start - 2;
+	assert(length <= 0xFFFF);
+	record[start] = length & 0xFF;
+	record[start + 1] = length >> 8;
 }
 
-bool Yaniv::checkDiscards(Player &player, string discards) {
-	if (!discards.length()) {
-		return false; // if discards is blank
+// puts the game back the way a snapshot (after its event byte) has it, returns the event after it
+const unsigned char *Yaniv::restoreSnapshot(const unsigned char *data) {
+	const unsigned char *end = data + 2 + (data[0] | data[1] << 8);
+	data += 2;
+	memcpy(&turnsPlayed, data, sizeof(turnsPlayed));
+	data += sizeof(turnsPlayed);
+	memcpy(rng.state, data, sizeof(rng.state));
+	data += sizeof(rng.state);
+	currentPlayer = *data++;
+	remainingPlayers = *data++;
+	faceUpTakes = *data++;
+	data = readCards(data, deck);
+	data = readCards(data, discardPile);
+	data = readCards(data, availableToTake);
+	nextAvailableToTake = availableToTake;
+	vector <Card> hand;
+	for (size_t i = 0; i < players.size(); i++) {
+		Player &player = players[i];
+		player.score = data[0] | data[1] << 8;
+		player.stillPlaying = data[2];
+		player.pointsInRound = 0; // only read after scoring sets it
+		data += 3;
+		data = readCards(data, hand);
+		player.clearHand();
+		for (size_t j = 0; j < hand.size(); j++)
+			player.addCard(hand[j]);
+		data = readCards(data, player.cardsDrawnPublicly);
+		CardSet unseen;
+		memcpy(&unseen, data, sizeof(CardSet));
+		data += sizeof(CardSet);
+		player.knowledge.reset();
+		for (CardSet seen = (SUITED_BITS | JOKER_BITS) & ~unseen; seen; seen &= seen - 1)
+			player.knowledge.see((Card)lowestCard(seen));
 	}
-	vector <string> cardsToDiscard;
-	string currCard;
-	for (size_t i = 0; i < discards.length() + 1; i++) {
-		if (discards[i] == ' ' || discards[i] == '\0') {
-			if (currCard.length()) {
-				cardsToDiscard.push_back(currCard);
+	return end;
+}
+
+// rebuilds a recorded game as it was before its turn-th turn (0 for the first) by playing its events from the last snapshot before then,
+// returns the turn it started from or -1 if the game ended first or this engine doesn't play the events the way the record says
+// the players and their rules must be set up as in the record (setUpGame with its header's rules)
+int Yaniv::replay(const GameRecordHeader &header, const unsigned char *events, int turn) {
+	const unsigned char *event = events, *end = events + header.bytes, *snapshot = NULL;
+	for (const unsigned char *next = events; next < end && *next != EVENT_END; ) {
+		int type = *next & 0xE0;
+		if (type == EVENT_SNAPSHOT) {
+			int snapshotTurn;
+			memcpy(&snapshotTurn, next + 3, sizeof(snapshotTurn));
+			if (snapshotTurn > turn) { break; }
+			snapshot = next;
+			next += 3 + (next[1] | next[2] << 8);
+		}
+		else if (type == EVENT_DEAL) {
+			++next;
+			for (int i = 0; i < header.players; i++)
+				next += 1 + *next;
+			++next;
+		}
+		else if (type == EVENT_TURN) { next += 3 + (next[1] & 31); }
+		else if (type == EVENT_YANIV) { next += 4; }
+		else { next += 3 + 2 * header.players; } // EVENT_SCORES
+	}
+	startGame(header.seed);
+	if (snapshot) {
+		event = restoreSnapshot(snapshot + 1);
+	}
+	int startTurn = turnsPlayed;
+	RoundResult round;
+	Move move;
+	while (event < end) {
+		int type = *event & 0xE0, low = *event & 31;
+		if ((type == EVENT_TURN || type == EVENT_YANIV) && turnsPlayed == turn) {
+			currentPlayer = (type == EVENT_TURN ? event[1] >> 5 : low); // players who are out are skipped before the turn starts
+			return startTurn;
+		}
+		if (type == EVENT_DEAL) {
+			// the first deal was made by startGame, later ones by the end of a round or a redeal
+			if (event != events) {
+				resetRound(low);
 			}
-			currCard = "";
+			const unsigned char *cards = event + 1;
+			for (size_t i = 0; i < players.size(); i++) {
+				if (!equal(players[i].hand.begin(), players[i].hand.end(), cards + 1) || players[i].hand.size() != *cards) { return -1; }
+				cards += 1 + *cards;
+			}
+			if (*cards != availableToTake.back()) { return -1; }
+			event = cards + 1;
 		}
-		else {
-			currCard += discards[i];
+		else if (type == EVENT_TURN) {
+			currentPlayer = event[1] >> 5;
+			Player &player = players[currentPlayer];
+			int count = event[1] & 31;
+			sortCards(player.hand);
+			++turnsPlayed;
+			move.discards.assign(event + 2, event + 2 + count);
+			move.source = (low & TOOK_DISCARD ? DISCARD_PILE : DRAW_PILE);
+			move.take = (low & TOOK_DISCARD ? event[2 + count] : NO_CARD);
+			move.slapdown = (low & SLAPPED_DOWN) != 0;
+			move.jokerSwap = (low & SWAPPED_JOKER) != 0;
+			Card slapdown;
+			if (applyMove(player, move, slapdown) != event[2 + count]) { return -1; }
+			availableToTake = nextAvailableToTake;
+			changeTurn();
+			event += 3 + count;
+		}
+		else if (type == EVENT_YANIV) {
+			currentPlayer = low;
+			Player &caller = players[currentPlayer];
+			sortCards(caller.hand);
+			++turnsPlayed;
+			if (caller.handPoints != event[1]) { return -1; }
+			scoreRound(caller, caller.handPoints, round);
+			event += 4;
+		}
+		else if (type == EVENT_SCORES) {
+			if (low != round.nextPlayer) { return -1; }
+			for (size_t i = 0; i < players.size(); i++) {
+				if (players[i].score != (event[3 + 2 * i] | event[4 + 2 * i] << 8)) { return -1; }
+			}
+			event += 3 + 2 * players.size();
+		}
+		else if (type == EVENT_SNAPSHOT) {
+			event += 3 + (event[1] | event[2] << 8);
+		}
+		else { // EVENT_END, the game is over before that turn
+			return -1;
 		}
 	}
+	return -1;
+}
 
-	for (size_t i = 0; i < cardsToDiscard.size(); i++) {
-		// if number of given card in hand is less than number in list to discard (ex. tried giving 2 J's when only has 1 or tried giving card that player doesn't have)
-		if (count(player.hand.begin(), player.hand.end(), cardsToDiscard[i]) < count(cardsToDiscard.begin(), cardsToDiscard.end(), cardsToDiscard[i])) {
-			cout << "You don't have " << cardsToDiscard[i] << "." << endl;
+// if other has every card in the same place (hands in the same order), the same scores, knowledge and turn and the same random numbers for the cards
+// (decisions reseed theirs every turn), what a replay or taking moves back has to get right
+bool Yaniv::sameState(const Yaniv &other) const {
+	if (currentPlayer != other.currentPlayer || remainingPlayers != other.remainingPlayers || turnsPlayed != other.turnsPlayed || faceUpTakes != other.faceUpTakes || players.size() != other.players.size()
+		|| deck != other.deck || discardPile != other.discardPile || availableToTake != other.availableToTake || nextAvailableToTake != other.nextAvailableToTake
+		|| !equal(rng.state, rng.state + 4, other.rng.state)) {
+		return false;
+	}
+	for (size_t i = 0; i < players.size(); i++) {
+		const Player &a = players[i], &b = other.players[i];
+		const CardKnowledge &known = a.knowledge, &otherKnown = b.knowledge;
+		if (a.hand != b.hand || a.handPoints != b.handPoints || a.handSet != b.handSet || a.cardsDrawnPublicly != b.cardsDrawnPublicly || a.score != b.score || a.stillPlaying != b.stillPlaying
+			|| known.unseen != otherKnown.unseen || known.count != otherKnown.count || known.points != otherKnown.points
+			|| !equal(known.rankCount, known.rankCount + NUM_RANKS + 1, otherKnown.rankCount)) {
 			return false;
 		}
 	}
+	return true;
+}
 
-	// check if all values are the same
-	bool validDiscard = true;
-	string firstCardValue = getValue(cardsToDiscard[0]);
-	for (size_t i = 1; i < cardsToDiscard.size(); i++) {
-		// if value on any remaining card is not the same as the first (and not a joker)
-		if (getValue(cardsToDiscard[i]) != firstCardValue && getValue(cardsToDiscard[i]) != "") {
-			validDiscard = false;
-			break;
+void Yaniv::makeAIPlayers(int numAI) {
+	players.clear();
+	numHuman = 0;
+	numPlayers = numAI;
+	for (int i = 0; i < numPlayers; i++) {
+		Player player;
+		player.AI = true;
+		player.name = "AI " + to_string(i + 1);
+		players.push_back(player);
+	}
+	resetGame(0);
+}
+
+float Yaniv::averageOfUnknowns(int observer) {
+	// average value of cards observer hasn't seen, tracked as cards are dealt and played
+	return players[observer].knowledge.average();
+}
+
+// chance that someone Assafs observer if they call Yaniv with points, atMost[p] (if given) is filled with the chance for every p up to points
+// from samples imagined hands (a multiple of ASSAF_BATCH)
+// every sample deals the cards observer hasn't seen as the others' cards that weren't drawn face up
+// samples are dealt a batch at a time and each player's points are added across the whole batch at once
+float Yaniv::assafRisk(int observer, int points, float *atMost, int samples) {
+	// points left in each player's known cards and how many cards they hold that observer hasn't seen
+	const CardKnowledge &knowledge = players[observer].knowledge;
+	int known[MAX_PLAYERS], hidden[MAX_PLAYERS];
+	int numOthers = 0, numHidden = 0;
+	for (size_t i = 0; i < players.size(); i++) {
+		if ((int)i == observer || !players[i].stillPlaying) {
+			continue;
 		}
+		int knownPoints = countPoints(players[i].cardsDrawnPublicly);
+		if (knownPoints > points) {
+			continue; // can't Assaf whatever their other cards are
+		}
+		int numUnknownCards = players[i].hand.size() - players[i].cardsDrawnPublicly.size();
+		// even the lowest unseen cards are too many points
+		int lowest = knownPoints;
+		for (int rank = 0, left = numUnknownCards; rank <= NUM_RANKS && left > 0; rank++) {
+			int taken = min(left, knowledge.rankCount[rank]);
+			lowest += taken * min(rank, 10);
+			left -= taken;
+		}
+		if (lowest > points) {
+			continue;
+		}
+		known[numOthers] = knownPoints;
+		hidden[numOthers++] = numUnknownCards;
+		numHidden += numUnknownCards;
+	}
+	if (atMost) {
+		fill(atMost, atMost + points + 1, 0.0f);
+	}
+	if (!numOthers) {
+		return 0;
 	}
 
-	// if not single, doubles, 3-of-a-kind, or 4-of-a-kind, check if it's a straight (3 or more cards)
-	if (!validDiscard && cardsToDiscard.size() >= 3) {
-		// check if straight of same suit
-		string currCardValue;
-		char firstCardSuit;
-		size_t start;
-		validDiscard = true;
-		// Get suit and value of first card that's NOT a Joker
-		for (size_t i = 0; i < cardsToDiscard.size(); i++) {
-			if (cardsToDiscard[i] != "J") {
-				currCardValue = getValue(cardsToDiscard[i]);
-				firstCardSuit = getSuit(cardsToDiscard[i]);
-				start = i + 1;
-				break;
-			}
+	unsigned char pool[NUM_CARDS];
+	int poolSize = 0;
+	for (CardSet unseen = knowledge.unseen; unseen; unseen &= unseen - 1)
+		pool[poolSize++] = (unsigned char)POINTS_OF[lowestCard(unseen)];
+	if (numHidden > poolSize) {
+		if (atMost) {
+			fill(atMost, atMost + points + 1, 1.0f);
 		}
-		for (size_t i = start; i < cardsToDiscard.size(); i++) {
-			// if not a joker, check card
-			if (cardsToDiscard[i] != "J") {
-				// if suit on any remaining card is not the same as the first
-				if (cardsToDiscard[i][cardsToDiscard[i].length() - 1] != firstCardSuit) {
-					validDiscard = false;
-					break;
-				}
-				// if value matches value after previous card's value (increment currCardValue to next one)
-				if (getValue(cardsToDiscard[i]) != nextValue(currCardValue)) {
-					validDiscard = false;
-					break;
+		return 1; // more hidden cards than unseen ones, knowledge is off so play it safe
+	}
+	// drawn[j][s] is the points of hidden card j in sample s, so the sums below run over contiguous samples
+	unsigned char drawn[NUM_CARDS][ASSAF_BATCH];
+	unsigned short total[ASSAF_BATCH], lowest[ASSAF_BATCH];
+	int assafs = 0;
+	Random random = aiRng; // a copy the compiler can keep in registers, the card stores could otherwise change aiRng
+	for (int batch = 0; batch < samples; batch += ASSAF_BATCH) {
+		// a partial shuffle of the pool deals each sample, the pool stays shuffled for the next one
+		// each random number picks four cards 16 bits at a time (bias is under 1 in 1000)
+		for (int s = 0; s < ASSAF_BATCH; s++) {
+			unsigned long long bits = 0;
+			for (int j = 0; j < numHidden; j++) {
+				if (!(j & 3)) {
+					bits = random.next();
 				}
+				swap(pool[j], pool[j + (int)(((bits & 0xFFFF) * (poolSize - j)) >> 16)]);
+				bits >>= 16;
+				drawn[j][s] = pool[j];
 			}
-			else {
-				// skip value that is replaced by Joker
-				nextValue(currCardValue);
-				// if next card is also Joker, skip a second time (ex. 7D J J 10D)
-				if (i != cardsToDiscard.size() - 1) {
-					if (cardsToDiscard[i + 1] == "J") {
-						nextValue(currCardValue);
-						i++;
-					}
-				}
-
+		}
+		fill(lowest, lowest + ASSAF_BATCH, 0xFFFF);
+		for (int i = 0, j = 0; i < numOthers; i++) {
+			fill(total, total + ASSAF_BATCH, known[i]);
+			for (int end = j + hidden[i]; j < end; j++) {
+				for (int s = 0; s < ASSAF_BATCH; s++)
+					total[s] += drawn[j][s];
 			}
+			for (int s = 0; s < ASSAF_BATCH; s++)
+				lowest[s] = min(lowest[s], total[s]);
 		}
-	}
-
-	// if valid single, doubles, 3-of-a-kind, or 4-of-a-kind, or straight
-	if (validDiscard) {
-		nextAvailableToTake.clear(); // clear available to take and refill with discards
-		for (size_t i = 0; i < cardsToDiscard.size(); i++) {
-			discardPile.push_back(cardsToDiscard[i]);
-			nextAvailableToTake.push_back(cardsToDiscard[i]);
-			player.hand.erase(find(player.hand.begin(), player.hand.end(), cardsToDiscard[i]));
-			if (count(player.cardsDrawnPublicly.begin(), player.cardsDrawnPublicly.end(), cardsToDiscard[i])) {
-				player.cardsDrawnPublicly.erase(find(player.cardsDrawnPublicly.begin(), player.cardsDrawnPublicly.end(), cardsToDiscard[i]));
+		for (int s = 0; s < ASSAF_BATCH; s++) {
+			if (lowest[s] <= points) {
+				++assafs;
+				if (atMost) { ++atMost[lowest[s]]; }
 			}
 		}
-		return true;
-	}
-	else {
-		cout << "The selected cards can not be discarded together." << endl;
-		return false;
 	}
+	aiRng = random;
+	// lowest hands counted at each total add up to the chance someone has at most that many points
+	for (int p = 0; atMost && p <= points; p++)
+		atMost[p] = (p ? atMost[p - 1] : 0) + atMost[p] / samples;
+	return (float)assafs / samples;
 }
 
-string Yaniv::prevValue(string value) {
-	if (value == "J") { value = "10"; }
-	else if (value == "Q") { value = "J"; }
-	else if (value == "K") { value = "Q"; }
-	else if (value == "A") { value = "--"; }
-	else if (value == "10") { value = "9"; }
-	else if (value.at(0) >= '2') { --value.at(0); }
-	else if (value == "2") { value = "A"; }
-	return value;
-}
-
-string Yaniv::nextValue(string &value) {
-	if (value == "10") { value = "J"; }
-	else if (value == "J") { value = "Q"; }
-	else if (value == "Q") { value = "K"; }
-	else if (value == "K") { value = "-"; }
-	else if (value == "A") { value = "2"; }
-	else if (value.at(0) <= '8') { ++value.at(0); }
-	else if (value == "9") { value = "10"; }
-	return value;
-}
-
-bool Yaniv::checkDraw(Player &player, string draw, string& slapdown) {
-	bool validDraw = false;
-	if (draw.size() == 0) { return false; }
-	if (draw.at(0) == 'D' && draw.length() == 1) {
-		// take from draw pile
-		dealCards(player);
-
-		if (CAN_SLAPDOWN) {
-			// check for slapdown
-			string drawnCard = player.hand.back();
-			if (getValue(drawnCard) == getValue(nextAvailableToTake.front()) && getValue(drawnCard) == getValue(nextAvailableToTake.back()) && drawnCard != "J") {
-				// ask if user wants to do slapdown
-				bool response;
-				string request = "Do you want to slap down the " + drawnCard + " you drew? (Y/N): ";
-				if (getYesOrNoResponse(response, request)) {
-					cout << "The " << drawnCard << " you drew was slapped down!" << endl;
-					slapdown = drawnCard;
-					player.hand.pop_back(); // remove last card from hand
-					discardPile.push_back(drawnCard); // add to discard pile
-					nextAvailableToTake.push_back(drawnCard); // add to end of next available to take
-				}
-			}
-		}
-
-		// sort and display hand
-		sortCards(player.hand);
-		cout << "Your hand: ";
-		printVector(player.hand);
+bool Yaniv::aiCallsYaniv(Player &activePlayer, int points) {
+	// check if has Yaniv
+	if (points > rules.minToCallYaniv) {
+		return false;
+	}
+	// if every card was slapped down there is nothing left to discard
+	if (activePlayer.hand.empty()) {
 		return true;
 	}
-	// if taking the first or last card that was played
-	else if (draw == availableToTake.front() || draw == availableToTake.back()) {
-		validDraw = true;
+	// call unless someone is too likely to have as few points or fewer and Assaf
+	// once the others' cards were all taken face up the chance is exact, so players left with one low card each that tie or beat
+	// each other never call and trade the same face-up cards until the round is redealt (most rounds that reach MAX_TURNS_PER_ROUND)
+	return assafRisk(currentPlayer, points) <= ASSAF_RISK_LIMIT;
+}
+
+// true if the AI calls Yaniv, otherwise move is what it plays
+template <class R>
+bool Yaniv::aiDecide(Player &activePlayer, int points, Move &move) {
+	bool callsYaniv = (activePlayer.playouts > 0 ? searchMove<R>(activePlayer, points, move) : aiHeuristicDecide<R>(activePlayer, points, move));
+	// when no one will call, taking the card the last player let go of can pass the same cards around the table for good (ex. players
+	// left with an ace each who can't call for fear of a tie), a card from the draw pile changes the hands
+	if (!callsYaniv && faceUpTakes >= FACE_UP_TAKES_LIMIT && move.source == DISCARD_PILE) {
+		move.source = DRAW_PILE;
+		move.take = NO_CARD;
+		move.jokerSwap = false;
+		move.slapdown = R::canSlapdown(rules) && !isJoker(move.discards.front()) && getValue(move.discards.front()) == getValue(move.discards.back());
 	}
-	// if the cards down are multiples of the same card
-	else if (availableToTake.front() == availableToTake.back() && availableToTake.front() != "J") {
-		// if can take any card when multiples are played, and requested card is available
-		if (CAN_TAKE_FROM_MIDDLE_OF_SET && count(availableToTake.begin(), availableToTake.end(), draw)) {
-			validDraw = true;
-		}
+	return callsYaniv;
+}
+
+// decision of an AI that doesn't search, small hands go to the endgame look-ahead and the rest follow the heuristic
+template <class R>
+bool Yaniv::aiHeuristicDecide(Player &activePlayer, int points, Move &move) {
+	if (activePlayer.hand.size() <= ENDGAME_CARDS) {
+		return endgameMove<R>(activePlayer, points, move);
 	}
-	// if the cards are a straight, you put 1 card down and are requesting a joker which exists in straight
-	else if (CAN_SWAP_JOKER && nextAvailableToTake.size() == 1 && draw == "J" && count(availableToTake.begin(), availableToTake.end(), "J")) {
-		// if card played is the joker's replacement
-		int JokerPos = find(availableToTake.begin(), availableToTake.end(), "J") - availableToTake.begin();
-		string cardPlayed = nextAvailableToTake.front(), nextCard = availableToTake[(JokerPos + 1)], prevCard = availableToTake[(JokerPos - 1)];
-		string cardPlayedValue = getValue(cardPlayed), nextCardValue = getValue(nextCard), prevCardValue = getValue(prevCard);
-		char cardPlayedSuit = getSuit(cardPlayed), nextCardSuit = getSuit(nextCard), prevCardSuit = getSuit(prevCard);
-		// if Joker is not the last card or first card
-		if (JokerPos != availableToTake.size() - 1 && JokerPos) {
-			// if next/prev card has same suit or is J AND next card has next value AND prev card has prev value
-			if ((nextCardSuit == cardPlayedSuit || nextCardSuit == 'J') &&
-				(prevCardSuit == cardPlayedSuit || prevCardSuit == 'J') &&
-				(prevCardValue == prevValue(cardPlayedValue)) &&
-				(nextCardValue == nextValue(cardPlayedValue))) {
-				validDraw = true;
-			}
-		}
-	}
-	if (validDraw) {
-		discardPile.erase(find(discardPile.begin(), discardPile.end(), draw));
-		player.hand.push_back(draw);
-		player.cardsDrawnPublicly.push_back(draw);
-		sortCards(player.hand);
-		cout << "Your hand: ";
-		printVector(player.hand);
+	if (aiCallsYaniv(activePlayer, points)) {
 		return true;
 	}
-	// if did not return true
-	cout << "You can't take that card." << endl;
+	aiChooseMove<R>(activePlayer, move);
 	return false;
 }
 
-string Yaniv::getValue(string card) {
-	return card.substr(0, card.length() - 1);
-}
+// best move for a small hand over the AI's turn and its next one, true to call Yaniv
+// this is a heuristic look-ahead rather than an exact solve: the other players' hands are unknown and their turns aren't played out,
+// the round is taken to end after the AI's next turn, and the chance of being Assaf-ed is estimated (see ENDGAME_RISK_WEIGHT)
+// drawn and face-up cards are taken to be any card the AI hasn't seen, and the chances of being Assaf-ed
+// and of another player ending the round between turns come from assafRisk
+// the AI's cost is the points it expects to lose: its hand if the round ends, its hand plus the penalty if it's Assaf-ed
+template <class R>
+bool Yaniv::endgameMove(Player &activePlayer, int points, Move &move) {
+	if (activePlayer.hand.empty()) {
+		return true; // every card was slapped down
+	}
+	int limit = min(rules.minToCallYaniv, ENDGAME_CARDS * 10);
+	assafRisk(currentPlayer, limit, endgameRisk, ENDGAME_SAMPLES);
+	endgameRoundEnds = endgameRisk[limit];
+	endgameUnseen = activePlayer.knowledge;
 
-char Yaniv::getSuit(string card) {
-	return card.at(card.length() - 1);
+	CardSet hand = activePlayer.handSet;
+	float bestCost = numeric_limits<float>::max();
+	bool callsYaniv = false, found = false;
+	if (points <= rules.minToCallYaniv) {
+		bestCost = min(1.0f, ENDGAME_RISK_WEIGHT * endgameRisk[points]) * (points + rules.assafPenalty);
+		callsYaniv = found = true;
+	}
+	for (CardSet discard = hand; discard; discard = (discard - 1) & hand) {
+		if (!isDiscardSet(discard)) {
+			continue;
+		}
+		CardSet kept = hand & ~discard;
+		int keptPoints = points - pointsInSet(discard);
+		orderDiscards(discard, endgameDiscards);
+		bool slapdown = R::canSlapdown(rules) && !isJoker(endgameDiscards.front()) && getValue(endgameDiscards.front()) == getValue(endgameDiscards.back());
+		// draw pile, a card of the value played is slapped down
+		if (endgameUnseen.count) {
+			// without a joker kept, a card drawn can only go in a series with a kept card of its suit one value away,
+			// so if there is none its next turn is the same for every suit of its value
+			float sameValue[NUM_RANKS + 1];
+			fill(sameValue, sameValue + NUM_RANKS + 1, -1.0f);
+			bool keptJoker = (kept & JOKER_BITS) != 0;
+			float cost = 0;
+			for (CardSet cards = endgameUnseen.unseen; cards; cards &= cards - 1) {
+				Card card = (Card)lowestCard(cards);
+				bool slapped = slapdown && RANK_OF[card] == RANK_OF[endgameDiscards.front()];
+				CardSet next = (slapped ? kept : kept | cardBit(card));
+				float nextTurn;
+				CardSet neighbours = ((cardBit(card) << 1) | (cardBit(card) >> 1)) & (SUIT_LANE << (SUIT_OF[card] * NUM_RANKS));
+				if (!isJoker(card) && !keptJoker && !(kept & neighbours)) {
+					float &value = sameValue[RANK_OF[card]];
+					if (value < 0)
+						value = endgameNextTurn<R>(next);
+					nextTurn = value;
+				}
+				else {
+					nextTurn = endgameNextTurn<R>(next);
+				}
+				cost += endgameRoundEnds * (keptPoints + (slapped ? 0 : POINTS_OF[card])) + (1 - endgameRoundEnds) * nextTurn;
+			}
+			cost /= endgameUnseen.count;
+			if (cost < bestCost) {
+				bestCost = cost;
+				callsYaniv = false;
+				found = true;
+				move.discards.assign(endgameDiscards.begin(), endgameDiscards.end());
+				move.source = DRAW_PILE;
+				move.take = NO_CARD;
+				move.slapdown = slapdown;
+				move.jokerSwap = false;
+			}
+		}
+		// face-up cards
+		for (size_t i = 0; i < availableToTake.size(); i++) {
+			Card card = availableToTake[i];
+			bool jokerSwap;
+			if (!canTake<R>(endgameDiscards, card, jokerSwap)) {
+				continue;
+			}
+			float cost = endgameRoundEnds * (keptPoints + POINTS_OF[card]) + (1 - endgameRoundEnds) * endgameNextTurn<R>(kept | cardBit(card));
+			if (cost < bestCost) {
+				bestCost = cost;
+				callsYaniv = false;
+				found = true;
+				move.discards.assign(endgameDiscards.begin(), endgameDiscards.end());
+				move.source = DISCARD_PILE;
+				move.take = card;
+				move.slapdown = false;
+				move.jokerSwap = jokerSwap;
+			}
+		}
+	}
+	if (!found) { // nothing to draw or take
+		aiChooseMove<R>(activePlayer, move);
+	}
+	return callsYaniv;
 }
 
-int Yaniv::getOrder(vector <string> hand, int i) {
-	string value = getValue(hand[i]);
-	if (value == "") { return 0; }
-	else if (value == "10") { return 10; }
-	else if (value == "J") { return 11; }
-	else if (value == "Q") { return 12; }
-	else if (value == "K") { return 13; }
-	else if (value == "A") { return 1; }
-	else if (value.at(0) <= '9') {
-		return value.at(0) - '0';
+// points the AI expects to lose if it starts its next turn with hand, the last turn the look-ahead sees (the round is taken to end after it)
+// the best of calling Yaniv and every discard with an average draw is compared with every face-up card it could find
+template <class R>
+float Yaniv::endgameNextTurn(CardSet hand) {
+	// cards that could be drawn or face up are the unseen ones not in hand
+	int count = endgameUnseen.count, unseenPoints = endgameUnseen.points;
+	int rankCount[NUM_RANKS + 1];
+	copy(endgameUnseen.rankCount, endgameUnseen.rankCount + NUM_RANKS + 1, rankCount);
+	for (CardSet held = hand & endgameUnseen.unseen; held; held &= held - 1) {
+		Card card = (Card)lowestCard(held);
+		--count;
+		unseenPoints -= POINTS_OF[card];
+		--rankCount[RANK_OF[card]];
 	}
-	return -1;
+	int handPoints = pointsInSet(hand);
+	float best = (float)handPoints;
+	if (count) {
+		best = numeric_limits<float>::max();
+		if (handPoints <= rules.minToCallYaniv) {
+			best = min(1.0f, ENDGAME_RISK_WEIGHT * endgameRisk[handPoints]) * (handPoints + rules.assafPenalty);
+		}
+		int leastKept = handPoints;
+		for (CardSet discard = hand; discard; discard = (discard - 1) & hand) {
+			if (!isDiscardSet(discard)) {
+				continue;
+			}
+			int kept = handPoints - pointsInSet(discard);
+			leastKept = min(leastKept, kept);
+			float drawn = (float)unseenPoints;
+			if (R::canSlapdown(rules) && !(discard & ~RANK_MASK[RANK_OF[lowestCard(discard)]]) && !(discard & JOKER_BITS)) {
+				int rank = RANK_OF[lowestCard(discard)];
+				drawn -= rankCount[rank] * min(rank, 10);
+			}
+			best = min(best, kept + drawn / count);
+		}
+		// a single face-up card can always be taken
+		float value = 0;
+		for (int rank = 0; rank <= NUM_RANKS; rank++)
+			value += rankCount[rank] * min(best, (float)(leastKept + min(rank, 10)));
+		best = value / count;
+	}
+	return best;
 }
 
-void Yaniv::sortCards(vector <string> &hand) {
-	size_t i;
+// cards of a discard set in the order they're played: jokers before multiples, series from low to high with jokers in the gaps or after the end
+void Yaniv::orderDiscards(CardSet discard, vector<Card> &cards) {
+	cards.clear();
+	CardSet suited = discard & SUITED_BITS;
+	CardSet jokers = discard & JOKER_BITS;
+	if (!suited || !(suited & ~RANK_MASK[RANK_OF[lowestCard(suited)]])) {
+		for (; jokers; jokers &= jokers - 1)
+			cards.push_back((Card)lowestCard(jokers));
+		for (; suited; suited &= suited - 1)
+			cards.push_back((Card)lowestCard(suited));
+		return;
+	}
+	int suit = SUIT_OF[lowestCard(suited)];
+	unsigned lane = suitLane(suited, suit);
+	int size = countCards(discard);
+	int first = min(RANK_OF[lowestCard(suited)], NUM_RANKS - size + 1);
+	for (int value = first; value < first + size; value++) {
+		if (lane >> (value - 1) & 1) {
+			cards.push_back(makeCard(value, suit));
+		}
+		else {
+			cards.push_back((Card)lowestCard(jokers));
+			jokers &= jokers - 1;
+		}
+	}
+}
+
+// every rollout deals the cards the AI hasn't seen at random, plays one of its choices and finishes the round with the heuristic AI
+// the most tried choice is played, threads pick choices at once and count their visit before the rollout is done so they spread out
+// with a budget no rollout starts after the deadline, so the search takes at most the budget and one rollout
+template <class R>
+bool Yaniv::searchMove(Player &activePlayer, int points, Move &move) {
+	chrono::steady_clock::time_point deadline = chrono::steady_clock::now() + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double, milli>(activePlayer.budget));
+	if (activePlayer.hand.empty()) {
+		return true; // every card was slapped down
+	}
+	// small hands go to the endgame look-ahead, rollouts against opponents that play them better only lose to it
+	if ((activePlayer.budget > 0 && activePlayer.budget < MIN_SEARCH_BUDGET) || activePlayer.hand.size() <= ENDGAME_CARDS) {
+		return aiHeuristicDecide<R>(activePlayer, points, move);
+	}
+	vector <Move> moves;
+	legalMoves<R>(activePlayer, moves);
+	// slapping down only ever helps, so don't spend rollouts on drawing the same card without it
+	for (size_t i = 0; i + 1 < moves.size(); i++) {
+		if (moves[i].slapdown && !moves[i + 1].slapdown && moves[i].discards == moves[i + 1].discards && moves[i + 1].source == DRAW_PILE)
+			moves.erase(moves.begin() + i + 1);
+	}
+	// the heuristic's choice is always tried, the rest of the rollouts go to the moves that get rid of the most points
+	Move chosen;
+	bool heuristicCalls = aiHeuristicDecide<R>(activePlayer, points, chosen);
+	float average = averageOfUnknowns(currentPlayer);
+	vector <pair<float, int>> ranked(moves.size());
+	for (size_t i = 0; i < moves.size(); i++) {
+		bool isChosen = (moves[i].discards == chosen.discards && moves[i].source == chosen.source && moves[i].take == chosen.take);
+		float kept = (moves[i].source == DISCARD_PILE ? pointsForCard(moves[i].take) : average) - countPoints(moves[i].discards);
+		ranked[i] = make_pair(isChosen ? -1e9f : kept, (int)i);
+	}
+	sort(ranked.begin(), ranked.end());
+	if (ranked.size() > SEARCH_CANDIDATES)
+		ranked.resize(SEARCH_CANDIDATES);
+	vector <Move> candidates;
+	for (size_t i = 0; i < ranked.size(); i++)
+		candidates.push_back(moves[ranked[i].second]);
+	moves.swap(candidates);
+	int numActions = moves.size() + (points <= rules.minToCallYaniv ? 1 : 0); // last choice is calling Yaniv
+	int heuristic = (heuristicCalls ? numActions - 1 : 0);
+	vector <ActionStats> stats(numActions);
+	atomic <long long> totalVisits(0);
+	atomic <bool> timeUp(false);
+	int observer = currentPlayer;
+	unsigned long long searchSeed = aiRng.next();
+	int threads = max(1, searchThreads);
+	vector <Yaniv*> worlds(threads, NULL);
+	vector <char> worldReady(threads, false);
+	parallelFor(activePlayer.playouts, threads, 16, [&](int id, long long begin, long long end) {
+		if (!worlds[id]) {
+			worlds[id] = new Yaniv;
+		}
+		Yaniv &world = *worlds[id];
+		for (long long i = begin; i < end; i++) {
+			// every thread stops at the deadline, the rollouts left are skipped
+			if (timeUp.load(memory_order_relaxed) || (activePlayer.budget > 0 && chrono::steady_clock::now() >= deadline)) {
+				timeUp.store(true, memory_order_relaxed);
+				return;
+			}
+			// upper confidence bound, choices not tried yet go first
+			double logTotal = log((double)(totalVisits.fetch_add(1) + 1));
+			int action = 0;
+			double bestBound = -1;
+			for (int a = 0; a < numActions; a++) {
+				long long visits = stats[a].visits.load();
+				double bound = (visits ? (double)stats[a].reward.load() / REWARD_SCALE / visits + EXPLORATION * sqrt(logTotal / visits) : 1e9);
+				if (bound > bestBound) {
+					bestBound = bound;
+					action = a;
+				}
+			}
+			// the nth rollout of every choice deals the same cards so choices are compared on the same deals
+			long long visit = stats[action].visits.fetch_add(1);
+			// after the first rollout the world only takes its moves back and deals the hidden cards again
+			if (!worldReady[id]) {
+				world.determinize(*this, observer, searchSeed + visit);
+				worldReady[id] = true;
+			}
+			else {
+				while (world.undoLog.size())
+					world.unmakeMove();
+				world.dealUnseen(*this, observer, searchSeed + visit);
+			}
+			double reward = world.playout<R>(observer, (action < (int)moves.size() ? &moves[action] : NULL), (activePlayer.budget > 0 ? &deadline : NULL));
+			if (reward < 0) { // cut off by the deadline, take back its visit
+				stats[action].visits.fetch_sub(1);
+				timeUp.store(true, memory_order_relaxed);
+				return;
+			}
+			stats[action].reward.fetch_add((long long)(reward * REWARD_SCALE));
+		}
+	});
+	for (int i = 0; i < threads; i++)
+		delete worlds[i];
+
+	int best = 0;
+	for (int a = 1; a < numActions; a++) {
+		if (stats[a].visits.load() > stats[best].visits.load())
+			best = a;
+	}
+	// the heuristic's choice stands unless the rollouts clearly found a better one, or if time ran out before every choice was tried
+	for (int a = 0; a < numActions; a++) {
+		if (!stats[a].visits.load())
+			best = heuristic;
+	}
+	if (heuristic < numActions && stats[heuristic].visits.load() && best != heuristic) {
+		double bestMean = (double)stats[best].reward.load() / REWARD_SCALE / stats[best].visits.load();
+		double heuristicMean = (double)stats[heuristic].reward.load() / REWARD_SCALE / stats[heuristic].visits.load();
+		if (bestMean - heuristicMean < SEARCH_MARGIN)
+			best = heuristic;
+	}
+	if (best == (int)moves.size()) {
+		return true;
+	}
+	move = moves[best];
+	return false;
+}
+
+// copies game as observer sees it: observer's hand and everything public stay, the cards observer hasn't seen are dealt at random
+void Yaniv::determinize(const Yaniv &game, int observer, unsigned long long worldSeed) {
+	rules = game.rules;
+	numPlayers = game.numPlayers;
+	numHuman = 0;
+	currentPlayer = game.currentPlayer;
+	remainingPlayers = game.remainingPlayers;
+	faceUpTakes = game.faceUpTakes;
+	players = game.players;
+	discardPile = game.discardPile;
+	availableToTake = game.availableToTake;
+	nextAvailableToTake = game.nextAvailableToTake;
+	history.clear();
+	undoLog.clear();
+	undoBytes.clear();
+	for (size_t i = 0; i < players.size(); i++) {
+		players[i].AI = true;
+		players[i].playouts = 0; // rollouts are played by the heuristic AI
+	}
+	dealUnseen(game, observer, worldSeed);
+}
+
+// deals again what observer hasn't seen, for a world determinized from game that has had its moves taken back since
+void Yaniv::dealUnseen(const Yaniv &game, int observer, unsigned long long worldSeed) {
+	// the round's scoring is the only thing unmakeMove doesn't take back
+	remainingPlayers = game.remainingPlayers;
+	rng.seed(worldSeed);
+	aiRng.seed(~worldSeed);
+
+	// other players keep the cards they drew publicly, their other cards and the draw pile come from the unseen cards
+	deck.clear();
+	for (CardSet unseen = players[observer].knowledge.unseen; unseen; unseen &= unseen - 1)
+		deck.push_back((Card)lowestCard(unseen));
+	shuffleCards(deck);
+	// other players are only known to have seen their own hand and the cards turned face up since the last reshuffle
+	CardSet faceUp = toCardSet(game.discardPile);
+	for (size_t i = 0; i < game.players.size(); i++)
+		faceUp |= toCardSet(game.players[i].cardsDrawnPublicly);
+	for (size_t i = 0; i < players.size(); i++) {
+		players[i].score = game.players[i].score;
+		players[i].pointsInRound = game.players[i].pointsInRound;
+		players[i].stillPlaying = game.players[i].stillPlaying;
+		if ((int)i == observer) {
+			continue;
+		}
+		size_t handSize = game.players[i].hand.size();
+		players[i].clearHand();
+		for (size_t j = 0; j < players[i].cardsDrawnPublicly.size(); j++)
+			players[i].addCard(players[i].cardsDrawnPublicly[j]);
+		while (players[i].hand.size() < handSize && deck.size()) {
+			players[i].addCard(deck.back());
+			deck.pop_back();
+		}
+		players[i].knowledge.restore((SUITED_BITS | JOKER_BITS) & ~(faceUp | players[i].handSet));
+	}
+}
+
+// plays firstMove (or calls Yaniv if NULL) and the rest of the round with makeMove so it can be taken back, returns how well observer did or -1 if the deadline passed first
+template <class R>
+double Yaniv::playout(int observer, const Move *firstMove, const chrono::steady_clock::time_point *deadline) {
+	RoundResult round;
+	Move move;
+	if (!firstMove) {
+		scoreRound<R>(players[observer], players[observer].handPoints, round);
+		return roundReward(observer, round);
+	}
+	makeMove<R>(*firstMove);
+	for (int turn = 0; turn < PLAYOUT_TURNS; turn++) {
+		if (deadline && chrono::steady_clock::now() >= *deadline) {
+			return -1;
+		}
+		Player &activePlayer = players[currentPlayer];
+		if (!activePlayer.stillPlaying) {
+			changeTurn();
+			continue;
+		}
+		sortCards(activePlayer.hand);
+		// every AI that doesn't search plays its endgames by the look-ahead, so rollouts play them the same way
+		if (aiHeuristicDecide<R>(activePlayer, activePlayer.handPoints, move)) {
+			scoreRound<R>(activePlayer, activePlayer.handPoints, round);
+			return roundReward(observer, round);
+		}
+		makeMove<R>(move);
+	}
+	// round went on too long, compare the hands held
+	round.caller = -1;
+	round.handPoints.assign(players.size(), 0);
+	round.eliminated.assign(players.size(), false);
+	for (size_t i = 0; i < players.size(); i++)
+		round.handPoints[i] = players[i].handPoints;
+	return roundReward(observer, round);
+}
+
+// 0.5 if observer lost as many points in the round as the average of the others, up to 1 if 100 fewer
+double Yaniv::roundReward(int observer, const RoundResult &round) {
+	double others = 0, own = 0;
+	int numOthers = 0;
+	for (size_t i = 0; i < players.size(); i++) {
+		if (!players[i].stillPlaying && !round.eliminated[i]) {
+			continue; // out before this round
+		}
+		double lost = (count(round.winners.begin(), round.winners.end(), (int)i) ? 0 : round.handPoints[i]);
+		if ((int)i == round.caller && round.assafers.size()) {
+			lost += rules.assafPenalty + rules.extraAssafPenalties * (round.assafers.size() - 1);
+		}
+		if ((int)i == observer) {
+			own = lost;
+		}
+		else {
+			others += lost;
+			++numOthers;
+		}
+	}
+	double reward = 0.5 + ((numOthers ? others / numOthers : 0) - own) / 100;
+	return min(1.0, max(0.0, reward));
+}
+
+template <class R>
+bool Yaniv::aiTakeTurn(Player &activePlayer, Move &move, Card &drawnCard, Card &slapdown) {
+	// plays the move from aiDecide
+	Card missingCard;
+	if (!validateMove<R>(activePlayer, move, missingCard)) {
+		drawnCard = slapdown = NO_CARD;
+		return false;
+	}
+	drawnCard = applyMove<R>(activePlayer, move, slapdown);
+	return true;
+}
+
+template <class R>
+void Yaniv::aiChooseMove(Player &activePlayer, Move &move) {
+	move.source = DRAW_PILE;
+	move.take = NO_CARD;
+	// best discards start with the card to draw, compare the cards after it
+	auto sameDiscards = [](const vector <Card> &a, const vector <Card> &b) {
+		return a.size() == b.size() && equal(a.begin() + 1, a.end(), b.begin() + 1);
+	};
+	// check if taking L or R will result in straight or set //
+	// if yes, find best discard of non-saved cards (highest point straight/set) and take face up card //
+	getBestDiscard<R>(activePlayer.hand, NO_CARDS, true, bestOfHand);
+	getBestDiscard<R>(activePlayer.hand, availableToTake, true, bestWithTaking);
+	// if taking makes a difference and taking allows playing more than 1 card (or AI can take a Joker)
+	if ((!sameDiscards(bestOfHand, bestWithTaking) && bestWithTaking.size() > 2) || isJoker(bestWithTaking.front())){
+		// get cards not used in combination with face up card
+		vector <Card> &cardsNotSaved = savedCards;
+		cardsNotSaved = activePlayer.hand;
+		for (size_t i = 0; i < bestWithTaking.size(); i++) {
+			if (count(cardsNotSaved.begin(), cardsNotSaved.end(), bestWithTaking[i])) {
+				cardsNotSaved.erase(find(cardsNotSaved.begin(), cardsNotSaved.end(), bestWithTaking[i]));
+			}
+		}
+		// if AI has cards to save
+		if (cardsNotSaved.size()) {
+			getBestDiscard<R>(cardsNotSaved, NO_CARDS, true, bestOfHand);
+		}
+		move.source = DISCARD_PILE;
+		move.take = bestWithTaking.front();
+	}
+	else {
+		// check if drawing an available card will help AI on next turn
+		bool drawnCardAlready = false;
+		savedCards = activePlayer.hand;
+		for (size_t i = 1; i < bestOfHand.size(); i++)	{
+			savedCards.erase(find(savedCards.begin(),savedCards.end(), bestOfHand[i]));
+		}
+		// if AI has cards to save
+		if (savedCards.size()) {
+			getBestDiscard<R>(savedCards, NO_CARDS, true, bestOfSaved);
+			getBestDiscard<R>(savedCards, availableToTake, false, bestOfSavedWithTaking);
+			// if taking makes a difference and taking allows playing more than 1 card (or AI can take a Joker)
+			if ((!sameDiscards(bestOfSaved, bestOfSavedWithTaking) && bestOfSavedWithTaking.size() > 2) || isJoker(bestOfSavedWithTaking.front())) {
+				// draw card from available
+				move.source = DISCARD_PILE;
+				move.take = bestOfSavedWithTaking.front();
+				drawnCardAlready = true;
+			}
+		}
+
+		if (!drawnCardAlready) {
+			// take from draw pile if:
+			// EITHER average of unknowns is less than the lower of available cards (left card is always smaller or equal to right card)
+			// OR your hand is very low, gamble for a card lower than available
+			int leftoverPts = activePlayer.handPoints;
+			for (size_t i = 1; i < bestOfHand.size(); i++)
+				leftoverPts -= pointsForCard(bestOfHand[i]);
+			if ((averageOfUnknowns(currentPlayer) < pointsForCard(availableToTake[0])) ||
+				(leftoverPts <= 7 && pointsForCard(availableToTake[0]) >= (8 - leftoverPts))) {
+				// take from draw pile
+				move.source = DRAW_PILE;
+			}
+			// if not, take smaller of face up cards
+			else {
+				move.source = DISCARD_PILE;
+				move.take = availableToTake[0];
+			}
+		}
+	}
+
+	// discard best of held cards //
+	move.discards.assign(bestOfHand.cbegin() + 1, bestOfHand.cend());
+	// slap down the drawn card if it has the value of every card played
+	move.slapdown = (move.source == DRAW_PILE && R::canSlapdown(rules) && !isJoker(move.discards.front()) && getValue(move.discards.front()) == getValue(move.discards.back()));
+	// a single card played on a series can take the joker it replaces
+	canTake<R>(move.discards, move.take, move.jokerSwap);
+}
+
+void Yaniv::makePlayers() {
+	bool response;
+
+	// Set up rule variations
+	if (!getYesOrNoResponse(response, "Do you want to play with the default rules? (Y/N): ")) {
+		/* NUMBERS */
+		cout << "How many cards should each player be dealt? (Default: 5) " << endl;
+		getPositiveNum(rules.cardsAtStart, "Enter a positive number of cards: "); // cards each player is dealt
+		cout << "What is the most points with which one can call Yaniv? (Default: 7) " << endl;
+		getPositiveNum(rules.minToCallYaniv, "Enter a positive number of points: "); // minimum points to call Yaniv
+		cout << "How many points does a player who is Assaf-ed receive as a penalty? (Default: 30) " << endl;
+		getPositiveNum(rules.assafPenalty, "Enter a positive number of points: "); // penalty for being Assaf-ed
+		cout << "How many extra points are given for each additional player who can call Assaf? (Default: 0) " << endl;
+		getPositiveNum(rules.extraAssafPenalties, "Enter a positive number of points: "); // additional penalties for each additional player who can Assaf you (usually 20 pts when applied)
+		cout << "How many points can a player receive before being eliminated? (Default: 200) " << endl;
+		getPositiveNum(rules.pointsLimit, "Enter a positive number of points: "); // Score that eliminates players
+
+		/* RULE VARIATIONS */
+		cout << "If a card of the same type that was played is drawn, can it be slapped down? (Default: Y) " << endl;
+		getYesOrNoResponse(rules.canSlapdown, "Enter 'Y' to allow slap-downs or 'N' to disallow: "); // if you draw from the draw pile the same type of card you just played, you can slap down your drawn card
+		cout << "If a player plays a series with a joker, can the next player swap the card it substitutes for the joker? (Default: Y) " << endl;
+		getYesOrNoResponse(rules.canSwapJoker, "Enter 'Y' to allow swapping for jokers or 'N' to disallow: "); // if next player has the card that goes in place of the joker, they can swap for it
+		cout << "If a player plays 3 or 4-of-a-kind is the next player allowed to take any card from the set they want? (Default: Y) " << endl;
+		getYesOrNoResponse(rules.canTakeFromMiddleOfSet, "Enter 'Y' to allow taking from middle of multiples sets or 'N' to disallow: "); // if 3-of-a-kind or 4-of-a-kind played, the next player may take any card from the set
+		cout << "When a player lands on a multiple of 50, are half of the points removed? (Default: Y) " << endl;
+		getYesOrNoResponse(rules.reductionIsHalf, "Enter 'Y' to remove HALF or 'N' to remove 50 POINTS on multiples of 50: "); // 50% reduction as opposed a 50-point reduction
+	}
+
+	int numAI;
+	while (true) {
+		cout << "How many humans? ";
+		cin >> numHuman;
+		numPlayers = numHuman;
+		if (cin.fail() || numPlayers < 0 || numPlayers > MAX_PLAYERS) {
+			cout << "The number of players must be between " << MIN_PLAYERS << " and " << MAX_PLAYERS << "." << endl;
+			cin.clear();
+			cin.ignore(numeric_limits<streamsize>::max(), '\n');
+		}
+		else {
+			cin.ignore();
+			break;
+		}
+	}
+	while (true) {
+		cout << "How many AIs? ";
+		cin >> numAI;
+		numPlayers = numHuman + numAI;
+		if (cin.fail() || numPlayers < MIN_PLAYERS || numPlayers > MAX_PLAYERS) {
+			cout << "The number of players must be between " << MIN_PLAYERS << " and " << MAX_PLAYERS << "." << endl;
+			cin.clear();
+			cin.ignore(numeric_limits<streamsize>::max(), '\n');
+		}
+		else {
+			cin.ignore();
+			break;
+		}
+	}
+
+	remainingPlayers = numPlayers;
+
+	// AIs that search play better but take longer to move
+	bool lookAhead = false;
+	if (numAI > 0) {
+		getYesOrNoResponse(lookAhead, "Should the AIs look ahead before each move (stronger but slower)? (Y/N): ");
+		searchThreads = max(1, (int)thread::hardware_concurrency());
+	}
+
+	// shuffle cards for extra randomness
+	shuffleCards(deck);
+
+	// make players array and deal 5 cards to each
+	for (int i = 0; i < numPlayers; i++) {
+		// add player to array
+		Player player;
+		players.push_back(player);
+
+		// set player name
+		while (true) {
+			// request name for player
+			string name;
+			cout << "Enter name for Player " << (i + 1);
+			if (i >= numHuman) { // set AI status of player to true
+				players[i].AI = true;
+				players[i].playouts = (lookAhead ? DEFAULT_PLAYOUTS : 0);
+				players[i].budget = INTERACTIVE_BUDGET;
+				cout << " [AI]";
+			}
+			cout << ": ";
+			getline(cin, name);
+			trim(name);
+
+			// check if name is valid (not taken and not blank)
+			bool nameTaken = false;
+			for (size_t j = 0; j < players.size() - 1; j++) {
+				if (players[j].name == name) {
+					nameTaken = true;
+					break;
+				}
+			}
+			if (nameTaken) {
+				cout << "That name is already being used." << endl;
+			}
+			else if (name.length() == 0) {
+				cout << "Name cannot be blank." << endl;
+			}
+			else {
+				players[i].name = name;
+				break;
+			}
+		}
+
+		// deal and sort cards
+		dealCards(players[i], rules.cardsAtStart);
+		sortCards(players[i].hand);
+	}
+
+	// make a card available for first player to take
+	revealCard(deck.back());
+	discardPile.push_back(deck.back());
+	availableToTake.push_back(deck.back());
+	nextAvailableToTake = availableToTake;
+	deck.pop_back();
+}
+
+void Yaniv::dealCards(Player &player, int numCards) {
+	for (int i = 0; i < numCards; i++) {
+		if (deck.empty()) {
+			reshuffleDiscards();
+		}
+		if (deck.empty()) {
+			return; // every card is in a hand or face up
+		}
+		// deck is kept shuffled, so take the card on top
+		player.addCard(deck.back());
+		player.knowledge.see(deck.back());
+		deck.pop_back(); // remove card from deck
+	}
+}
+
+void Yaniv::reshuffleDiscards() {
+	// move discard pile back into deck, leave available cards in discard pile
+	size_t cardsToTransfer = discardPile.size() - nextAvailableToTake.size();
+	deck.insert(deck.end(), discardPile.begin(), discardPile.begin() + cardsToTransfer);
+	for (size_t i = 0; i < cardsToTransfer; i++) {
+		for (size_t j = 0; j < players.size(); j++)
+			players[j].knowledge.forget(discardPile[i]);
+	}
+	discardPile.erase(discardPile.begin(), discardPile.begin() + cardsToTransfer);
+	shuffleCards(deck);
+}
+
+void Yaniv::printVector(const vector<Card> &v) {
+	for (size_t i = 0; i < v.size(); i++) {
+		cout << cardToString(v[i]) << " ";
+	}
+	cout << endl;
+}
+
+bool Yaniv::parseDiscards(const Player &player, string discards, vector<Card> &cardsToDiscard) {
+	cardsToDiscard.clear();
+	if (!discards.length()) {
+		return false; // if discards is blank
+	}
+	string currCard;
+	for (size_t i = 0; i < discards.length() + 1; i++) {
+		if (discards[i] == ' ' || discards[i] == '\0') {
+			if (currCard.length()) {
+				Card card;
+				if (!parseCard(currCard, card)) {
+					cout << "You don't have " << currCard << "." << endl;
+					return false;
+				}
+				// each "J" refers to a different joker in the player's hand
+				if (isJoker(card) && (count(cardsToDiscard.begin(), cardsToDiscard.end(), JOKER_1) || !count(player.hand.begin(), player.hand.end(), JOKER_1))) {
+					card = JOKER_2;
+				}
+				cardsToDiscard.push_back(card);
+			}
+			currCard = "";
+		}
+		else {
+			currCard += discards[i];
+		}
+	}
+
+	Card missingCard;
+	if (!canDiscard(player, cardsToDiscard, missingCard)) {
+		if (missingCard != NO_CARD) {
+			cout << "You don't have " << cardToString(missingCard) << "." << endl;
+		}
+		else if (cardsToDiscard.size()) {
+			cout << "The selected cards can not be discarded together." << endl;
+		}
+		return false;
+	}
+	return true;
+}
+
+template <class R>
+bool Yaniv::parseDraw(string drawStr, Move &move) {
+	move.slapdown = false; // asked for once the card is drawn
+	move.jokerSwap = false;
+	if (drawStr == "D") {
+		move.source = DRAW_PILE;
+		move.take = NO_CARD;
+		return true;
+	}
+	Card draw;
+	if (!parseCard(drawStr, draw)) {
+		cout << "You can't take that card." << endl;
+		return false;
+	}
+	// "J" refers to whichever joker is available to take
+	if (isJoker(draw) && !count(availableToTake.begin(), availableToTake.end(), JOKER_1)) {
+		draw = JOKER_2;
+	}
+	if (!canTake<R>(move.discards, draw, move.jokerSwap)) {
+		cout << "You can't take that card." << endl;
+		return false;
+	}
+	move.source = DISCARD_PILE;
+	move.take = draw;
+	return true;
+}
+
+bool Yaniv::canDiscard(const Player &player, const vector<Card> &cardsToDiscard, Card &missingCard) {
+	missingCard = NO_CARD;
+	if (!cardsToDiscard.size()) {
+		return false; // if nothing to discard
+	}
+	CardSet handSet = player.handSet;
+	CardSet discardSet = 0;
+	for (size_t i = 0; i < cardsToDiscard.size(); i++) {
+		// if card is not in hand or was already listed (ex. tried giving 2 J's when only has 1 or tried giving card that player doesn't have)
+		if (!(handSet & cardBit(cardsToDiscard[i])) || (discardSet & cardBit(cardsToDiscard[i]))) {
+			missingCard = cardsToDiscard[i];
+			return false;
+		}
+		discardSet |= cardBit(cardsToDiscard[i]);
+	}
+
+	// check if all values are the same (jokers can be played with any multiples)
+	CardSet suited = discardSet & SUITED_BITS;
+	bool validDiscard = !suited || !(suited & ~RANK_MASK[RANK_OF[lowestCard(suited)]]);
+
+	// if not single, doubles, 3-of-a-kind, or 4-of-a-kind, check if it's a straight (3 or more cards)
+	if (!validDiscard && cardsToDiscard.size() >= 3) {
+		// all cards that are NOT a Joker must be in the same suit lane
+		int suit = SUIT_OF[lowestCard(suited)];
+		validDiscard = !(suited & ~(SUIT_LANE << (suit * NUM_RANKS)));
+		// value the series starts at, found from the first card that's NOT a Joker
+		int firstValue = 0;
+		for (size_t i = 0; i < cardsToDiscard.size(); i++) {
+			if (!isJoker(cardsToDiscard[i])) {
+				firstValue = getValue(cardsToDiscard[i]) - i;
+				break;
+			}
+		}
+		// series must fit between A and K and every card must be in its place (jokers fill the rest)
+		int size = cardsToDiscard.size();
+		if (firstValue < 1 || firstValue + size - 1 > NUM_RANKS) {
+			validDiscard = false;
+		}
+		else {
+			// the cards' ranks have to fit in the series, then each has to be in its place
+			validDiscard = validDiscard && LANE_SPAN[suitLane(suited, suit)] <= size;
+			for (int i = 0; i < size && validDiscard; i++) {
+				if (!isJoker(cardsToDiscard[i]) && getValue(cardsToDiscard[i]) != firstValue + i) {
+					validDiscard = false;
+				}
+			}
+		}
+	}
+
+	// if valid single, doubles, 3-of-a-kind, or 4-of-a-kind, or straight
+	return validDiscard;
+}
+
+template <class R>
+bool Yaniv::canTake(const vector<Card> &discards, Card take, bool &jokerSwap) {
+	jokerSwap = false;
+	if (!count(availableToTake.begin(), availableToTake.end(), take)) {
+		return false;
+	}
+	// if taking the first or last card that was played
+	if (take == availableToTake.front() || take == availableToTake.back()) {
+		return true;
+	}
+	// if the cards down are multiples of the same card, can take any card if the rules allow it
+	if (getValue(availableToTake.front()) == getValue(availableToTake.back()) && !isJoker(availableToTake.front())) {
+		return R::canTakeFromMiddleOfSet(rules);
+	}
+	// if the cards are a straight, you put 1 card down and are requesting a joker which exists in straight
+	if (R::canSwapJoker(rules) && discards.size() == 1 && isJoker(take)) {
+		// if card played is the joker's replacement (joker is not first or last, checked above)
+		int JokerPos = find(availableToTake.begin(), availableToTake.end(), take) - availableToTake.begin();
+		Card cardPlayed = discards.front(), nextCard = availableToTake[(JokerPos + 1)], prevCard = availableToTake[(JokerPos - 1)];
+		int cardPlayedValue = getValue(cardPlayed), nextCardValue = getValue(nextCard), prevCardValue = getValue(prevCard);
+		char cardPlayedSuit = getSuit(cardPlayed), nextCardSuit = getSuit(nextCard), prevCardSuit = getSuit(prevCard);
+		// if next/prev card has same suit or is J AND next card has next value AND prev card has prev value
+		if ((nextCardSuit == cardPlayedSuit || nextCardSuit == 'J') &&
+			(prevCardSuit == cardPlayedSuit || prevCardSuit == 'J') &&
+			(prevCardValue == prevValue(cardPlayedValue)) &&
+			(nextCardValue == nextValue(cardPlayedValue))) {
+			jokerSwap = true;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool Yaniv::matchesDiscards(Card drawnCard) {
+	// a card drawn from the draw pile can be slapped down if it has the value of the cards just played
+	return !isJoker(drawnCard) && getValue(drawnCard) == getValue(nextAvailableToTake.front()) && getValue(drawnCard) == getValue(nextAvailableToTake.back());
+}
+
+template <class R>
+bool Yaniv::validateMove(const Player &player, const Move &move, Card &missingCard) {
+	if (!canDiscard(player, move.discards, missingCard)) {
+		return false;
+	}
+	if (move.source == DRAW_PILE) {
+		bool canSlapdown = R::canSlapdown(rules) && !isJoker(move.discards.front()) && getValue(move.discards.front()) == getValue(move.discards.back());
+		return move.take == NO_CARD && (!move.slapdown || canSlapdown) && !move.jokerSwap;
+	}
+	bool jokerSwap;
+	return !move.slapdown && canTake<R>(move.discards, move.take, jokerSwap) && jokerSwap == move.jokerSwap;
+}
+
+// plays a move that passed validateMove, returns the card drawn (NO_CARD if the draw pile was empty)
+template <class R>
+Card Yaniv::applyMove(Player &player, const Move &move, Card &slapdown) {
+	slapdown = NO_CARD;
+	discardCards(player, move.discards);
+	if (move.source == DISCARD_PILE) {
+		faceUpTakes = min(faceUpTakes + 1, 0xFF);
+		discardPile.erase(find(discardPile.begin(), discardPile.end(), move.take));
+		player.addCard(move.take);
+		player.cardsDrawnPublicly.push_back(move.take);
+		return move.take;
+	}
+	faceUpTakes = 0;
+	size_t handSize = player.hand.size();
+	dealCards(player);
+	if (player.hand.size() == handSize) {
+		return NO_CARD;
+	}
+	Card drawnCard = player.hand.back();
+	if (move.slapdown && R::canSlapdown(rules) && matchesDiscards(drawnCard)) {
+		slapdown = drawnCard;
+		slapDown(player, drawnCard);
+	}
+	return drawnCard;
+}
+
+// plays move for the current player if it is legal (if not they pass) and ends the turn, logging only what changed so unmakeMove can take it back
+template <class R>
+bool Yaniv::makeMove(const Move &move) {
+	Player &player = players[currentPlayer];
+	UndoRecord undo;
+	undo.player = currentPlayer;
+	undo.faceUpTakes = faceUpTakes;
+	undo.bytes = undoBytes.size();
+	undo.numAvailable = availableToTake.size();
+	undoBytes.insert(undoBytes.end(), availableToTake.begin(), availableToTake.end());
+	Card missingCard;
+	undo.played = validateMove<R>(player, move, missingCard);
+	if (undo.played) {
+		// the discards come out of the hand one at a time, so each place is counted after the ones before it are gone
+		undoHand = player.hand;
+		undoPublic = player.cardsDrawnPublicly;
+		for (size_t i = 0; i < move.discards.size(); i++) {
+			Card card = move.discards[i];
+			vector <Card>::iterator inHand = find(undoHand.begin(), undoHand.end(), card);
+			vector <Card>::iterator inPublic = find(undoPublic.begin(), undoPublic.end(), card);
+			unsigned char unseenBy = 0;
+			for (size_t j = 0; j < players.size(); j++) {
+				if (players[j].knowledge.unseen & cardBit(card))
+					unseenBy |= 1 << j;
+			}
+			undoBytes.push_back(card);
+			undoBytes.push_back(inHand - undoHand.begin());
+			undoBytes.push_back(inPublic != undoPublic.end() ? inPublic - undoPublic.begin() : NO_CARD);
+			undoBytes.push_back(unseenBy);
+			undoHand.erase(inHand);
+			if (inPublic != undoPublic.end())
+				undoPublic.erase(inPublic);
+		}
+		undo.numDiscards = move.discards.size();
+		if (move.source == DISCARD_PILE) {
+			undo.take = move.take;
+			undo.takenFrom = find(discardPile.begin(), discardPile.end(), move.take) - discardPile.begin();
+		}
+		else if (deck.empty()) {
+			// a reshuffle changes too much to take back card by card, keep what it changes instead
+			undo.reshuffled = true;
+			const unsigned char *state = (const unsigned char*)rng.state;
+			undoBytes.insert(undoBytes.end(), state, state + sizeof(rng.state));
+			undoBytes.push_back(discardPile.size());
+			undoBytes.insert(undoBytes.end(), discardPile.begin(), discardPile.end());
+			for (size_t j = 0; j < players.size(); j++) {
+				const unsigned char *unseen = (const unsigned char*)&players[j].knowledge.unseen;
+				undoBytes.insert(undoBytes.end(), unseen, unseen + sizeof(CardSet));
+			}
+		}
+		else {
+			for (size_t j = 0; j < players.size(); j++) {
+				if (players[j].knowledge.unseen & cardBit(deck.back()))
+					undo.drawnUnseen |= 1 << j;
+			}
+		}
+		Card slapdown;
+		Card drawn = applyMove<R>(player, move, slapdown);
+		if (move.source == DRAW_PILE)
+			undo.drawn = drawn;
+		undo.slapdown = (slapdown != NO_CARD);
+	}
+	availableToTake = nextAvailableToTake;
+	changeTurn();
+	undoLog.push_back(undo);
+	return undo.played;
+}
+
+// takes back the last move made with makeMove, call it again to go back further
+void Yaniv::unmakeMove() {
+	UndoRecord undo = undoLog.back();
+	undoLog.pop_back();
+	currentPlayer = undo.player;
+	faceUpTakes = undo.faceUpTakes;
+	Player &player = players[currentPlayer];
+	const unsigned char *bytes = &undoBytes[undo.bytes];
+	// the cards that could be taken were the next ones too until the player discarded
+	availableToTake.assign(bytes, bytes + undo.numAvailable);
+	nextAvailableToTake = availableToTake;
+	bytes += undo.numAvailable;
+	if (undo.played) {
+		const unsigned char *discards = bytes;
+		bytes += 4 * undo.numDiscards;
+		// the card taken or drawn leaves the hand (a card slapped down already left it)
+		if (undo.take != NO_CARD) {
+			player.removeCard(undo.take);
+			player.cardsDrawnPublicly.pop_back();
+		}
+		if (undo.drawn != NO_CARD && !undo.slapdown) {
+			player.removeCard(undo.drawn);
+		}
+		if (undo.reshuffled) {
+			// the draw pile was empty and the discard pile held everything before the discards
+			memcpy(rng.state, bytes, sizeof(rng.state));
+			bytes += sizeof(rng.state);
+			deck.clear();
+			discardPile.assign(bytes + 1, bytes + 1 + *bytes);
+			bytes += 1 + *bytes;
+			for (size_t j = 0; j < players.size(); j++) {
+				CardSet unseen;
+				memcpy(&unseen, bytes, sizeof(CardSet));
+				bytes += sizeof(CardSet);
+				players[j].knowledge.restore(unseen);
+			}
+		}
+		else {
+			if (undo.slapdown)
+				discardPile.pop_back();
+			if (undo.drawn != NO_CARD) {
+				deck.push_back(undo.drawn);
+				for (size_t j = 0; j < players.size(); j++) {
+					if (undo.drawnUnseen >> j & 1)
+						players[j].knowledge.forget(undo.drawn);
+				}
+			}
+			if (undo.take != NO_CARD)
+				discardPile.insert(discardPile.begin() + undo.takenFrom, undo.take);
+			discardPile.resize(discardPile.size() - undo.numDiscards);
+		}
+		for (int i = undo.numDiscards - 1; i >= 0; i--) {
+			const unsigned char *discard = discards + 4 * i;
+			player.insertCard(discard[0], discard[1]);
+			if (discard[2] != NO_CARD)
+				player.cardsDrawnPublicly.insert(player.cardsDrawnPublicly.begin() + discard[2], discard[0]);
+			for (size_t j = 0; j < players.size() && !undo.reshuffled; j++) {
+				if (discard[3] >> j & 1)
+					players[j].knowledge.forget(discard[0]);
+			}
+		}
+	}
+	undoBytes.resize(undo.bytes);
+}
+
+// every move the player can make this turn
+template <class R>
+void Yaniv::legalMoves(const Player &player, vector<Move> &moves) {
+	moves.clear();
+	vector <vector <Card> > discardOptions;
+	legalDiscards(player.hand, discardOptions);
+	for (size_t i = 0; i < discardOptions.size(); i++) {
+		Move move;
+		move.discards = discardOptions[i];
+		moves.push_back(move);
+		// slapping down is only possible if every card played has the same value
+		if (R::canSlapdown(rules) && !isJoker(move.discards.front()) && getValue(move.discards.front()) == getValue(move.discards.back())) {
+			moves.back().slapdown = true;
+			moves.push_back(move);
+		}
+		move.source = DISCARD_PILE;
+		for (size_t j = 0; j < availableToTake.size(); j++) {
+			move.take = availableToTake[j];
+			if (canTake<R>(move.discards, move.take, move.jokerSwap)) {
+				moves.push_back(move);
+			}
+		}
+	}
+}
+
+// every set of cards from hand that can be discarded together, jokers placed every way they fit in a series
+void Yaniv::legalDiscards(const vector<Card> &hand, vector <vector <Card> > &discards) {
+	discards.clear();
+	size_t size = hand.size();
+	for (unsigned long long subset = 1; subset < (1ULL << size); subset++) {
+		CardSet cards = 0;
+		for (size_t i = 0; i < size; i++) {
+			if (subset >> i & 1)
+				cards |= cardBit(hand[i]);
+		}
+		CardSet suited = cards & SUITED_BITS;
+		vector <Card> jokers;
+		for (CardSet rest = cards & JOKER_BITS; rest; rest &= rest - 1)
+			jokers.push_back((Card)lowestCard(rest));
+
+		// singles, multiples and jokers (jokers can be played with any multiples)
+		if (!suited || !(suited & ~RANK_MASK[RANK_OF[lowestCard(suited)]])) {
+			vector <Card> multiple = jokers;
+			for (; suited; suited &= suited - 1)
+				multiple.push_back((Card)lowestCard(suited));
+			discards.push_back(multiple);
+			continue;
+		}
+
+		// series of 3 or more in one suit, jokers fill the gaps and can go on either end
+		int suit = SUIT_OF[lowestCard(suited)];
+		if (countCards(cards) < 3 || (suited & ~(SUIT_LANE << (suit * NUM_RANKS)))) {
+			continue;
+		}
+		unsigned lane = suitLane(suited, suit);
+		int low = RANK_OF[lowestCard(suited)];
+		int high = low;
+		while (lane >> high)
+			++high;
+		int extraJokers = (int)jokers.size() - (high - low + 1 - countCards(suited));
+		for (int below = 0; below <= extraJokers; below++) {
+			int first = low - below, last = high + extraJokers - below;
+			if (first < 1 || last > NUM_RANKS) {
+				continue;
+			}
+			vector <Card> series;
+			size_t nextJoker = 0;
+			for (int value = first; value <= last; value++) {
+				if (lane >> (value - 1) & 1)
+					series.push_back(makeCard(value, suit));
+				else
+					series.push_back(jokers[nextJoker++]);
+			}
+			discards.push_back(series);
+		}
+	}
+}
+
+void Yaniv::discardCards(Player &player, const vector<Card> &cardsToDiscard) {
+	nextAvailableToTake.clear(); // clear available to take and refill with discards
+	for (size_t i = 0; i < cardsToDiscard.size(); i++) {
+		discardPile.push_back(cardsToDiscard[i]);
+		nextAvailableToTake.push_back(cardsToDiscard[i]);
+		player.removeCard(cardsToDiscard[i]);
+		revealCard(cardsToDiscard[i]);
+		if (count(player.cardsDrawnPublicly.begin(), player.cardsDrawnPublicly.end(), cardsToDiscard[i])) {
+			player.cardsDrawnPublicly.erase(find(player.cardsDrawnPublicly.begin(), player.cardsDrawnPublicly.end(), cardsToDiscard[i]));
+		}
+	}
+}
+
+void Yaniv::slapDown(Player &player, Card card) {
+	player.removeCard(card); // remove last card from hand
+	discardPile.push_back(card); // add to discard pile
+	nextAvailableToTake.push_back(card); // add to end of next available to take
+	revealCard(card);
+}
+
+void Yaniv::revealCard(Card card) {
+	// every player sees a card turned face up
+	for (size_t i = 0; i < players.size(); i++)
+		players[i].knowledge.see(card);
+}
+
+int Yaniv::prevValue(int value) {
+	return PREV_RANK[value]; // nothing before an Ace
+}
+
+int Yaniv::nextValue(int value) {
+	return NEXT_RANK[value]; // nothing after a King
+}
+
+
+int Yaniv::getValue(Card card) {
+	return RANK_OF[card]; // Joker is 0
+}
+
+char Yaniv::getSuit(Card card) {
+	return SUIT_CHARS[SUIT_OF[card]]; // Joker is 'J'
+}
+
+int Yaniv::getOrder(Card card) {
+	return RANK_OF[card]; // jokers first, then A-K
+}
+
+void Yaniv::sortCards(vector <Card> &hand) {
+	size_t i;
 	int j, key;
-	string keyStr;
+	Card keyCard;
 	for (i = 1; i < hand.size(); i++) {
-		keyStr = hand[i];
-		key = getOrder(hand, i); //arr[i];
+		keyCard = hand[i];
+		key = getOrder(keyCard); //arr[i];
 		j = i - 1;
-		while (j >= 0 && getOrder(hand, j) > key) { // arr[j]
+		while (j >= 0 && getOrder(hand[j]) > key) { // arr[j]
 			hand[j + 1] = hand[j]; // arr[j]
 			j = j - 1;
 		}
-		hand[j + 1] = keyStr;
-	}
+		hand[j + 1] = keyCard;
+	}
+}
+
+int Yaniv::pointsForCard(Card card) {
+	return POINTS_OF[card];
+}
+
+int Yaniv::countPoints(const vector <Card> &hand) {
+	int sum = 0;
+	for (size_t i = 0; i < hand.size(); i++) {
+		sum += pointsForCard(hand[i]);
+	}
+	return sum;
+}
+
+int Yaniv::callYaniv(Player &activePlayer, int activePlayerPoints) {
+	RoundResult round;
+	int winner = scoreRound(activePlayer, activePlayerPoints, round);
+
+	cout << endl << activePlayer.name << "'s hand: ";
+	cout << "(" << activePlayerPoints << " point" << (activePlayerPoints != 1 ? "s) " : ") ");
+	printVector(activePlayer.hand);
+
+	for (size_t i = 0; i < players.size(); i++) {
+		if (((int)i != currentPlayer) && (players[i].stillPlaying || round.eliminated[i])) {
+			cout << players[i].name << "'s hand: ";
+			cout << "(" << round.handPoints[i] << " point" << (round.handPoints[i] != 1 ? "s) " : ") ");
+			printVector(players[i].hand);
+		}
+	}
+
+	// if active player was Assaf-ed, print Assaf-ers
+	if (round.assafers.size()) {
+		cout << players[currentPlayer].name << " was Assaf-ed by " << players[round.assafers.front()].name;
+		for (size_t i = 1; i < round.assafers.size(); i++)
+			cout << " and " << players[round.assafers[i]].name; // add name to assaf list
+		cout << "." << endl;
+	}
+
+	// print winners
+	cout << players[round.winners.front()].name << " ";
+	for (size_t i = 1; i < round.winners.size(); i++)
+		cout << "and " << players[round.winners[i]].name << " ";
+	cout << "won the round." << endl;
+
+	cout << endl << "SCOREBOARD:" << endl;
+
+	for (size_t i = 0; i < players.size(); i++) {
+		// print player's name and score
+		cout << players[i].name << ": " << players[i].score << " point" << (players[i].score != 1 ? "s" : "");
+		// add message if score was halved
+		if (round.scoreReduced[i]) {
+			cout << " -- " << players[i].name << (rules.reductionIsHalf ? "'s score was halved!" : "'s score was deducted by 50!");
+		}
+		// players who went over the max are out
+		if (players[i].score > rules.pointsLimit) {
+			cout << " -- OUT";
+		}
+		cout << endl;
+	}
+	cout << endl;
+
+	return winner;
+}
+
+template <class R>
+int Yaniv::scoreRound(Player &activePlayer, int activePlayerPoints, RoundResult &round) {
+	int lowestPts = activePlayerPoints;
+	activePlayer.pointsInRound = activePlayerPoints;
+	int winner = currentPlayer;
+	round.caller = currentPlayer;
+	round.handPoints.assign(players.size(), 0);
+	round.handPoints[currentPlayer] = activePlayerPoints;
+	round.winners.clear();
+	round.assafers.clear();
+	round.scoreReduced.assign(players.size(), false);
+	round.eliminated.assign(players.size(), false);
+
+	for (size_t i = 0; i < players.size(); i++) {
+		if (((int)i != currentPlayer) && (players[i].stillPlaying)) {
+			players[i].pointsInRound = players[i].handPoints;
+			round.handPoints[i] = players[i].pointsInRound;
+			if (players[i].pointsInRound <= lowestPts) {
+				lowestPts = players[i].pointsInRound;
+				winner = i;
+			}
+		}
+	}
+
+	players[winner].pointsInRound = 0; // winner gets 0 for round
+	round.winners.push_back(winner); // add winner to potential players who can start next round (if only winner, they will start next round)
+
+	// if active player was Assaf-ed, deduct penalty
+	if (winner != currentPlayer) {
+		round.assafers.push_back(winner);
+		activePlayer.score += rules.assafPenalty; // penalty
+
+		// check if assaf was a tie
+		for (size_t i = 0; i < players.size(); i++) {
+			if ((int)i != currentPlayer && (int)i != winner && players[i].stillPlaying) { // if not caller of yaniv or declared winner with assaf
+				// if playing with extra penalties, usually 20 extra points are deducted for additional Assafs
+				if (players[i].pointsInRound <= activePlayerPoints) {
+					round.assafers.push_back(i); // add to assaf list
+					activePlayer.score += rules.extraAssafPenalties; // default is 0, but some variations add 20 points here
+				}
+				if (players[i].pointsInRound == lowestPts) { // if player has same amount as winner with assaf
+					players[i].pointsInRound = 0; // also gets 0 for round
+					round.winners.push_back(i); // give potential for this player to be first player next round
+				}
+			}
+		}
+	}
+
+	for (size_t i = 0; i < players.size(); i++) {
+		players[i].score += players[i].pointsInRound;
+		// if score is divisible by 50 and score increased (i.e. 50, 100, 150, 200), halve score
+		if (players[i].pointsInRound > 0 && players[i].score % 50 == 0) {
+			if (R::reductionIsHalf(rules)) { players[i].score /= 2; } // if true, halve score
+			else { players[i].score -= 50; } // if false, deduct 50
+			round.scoreReduced[i] = true;
+		}
+		// knock players out of round if hit max
+		if (players[i].score > rules.pointsLimit && players[i].stillPlaying) {
+			players[i].pointsInRound = 0;
+			players[i].stillPlaying = false; // will be skipped in future rounds
+			round.eliminated[i] = true;
+			--remainingPlayers; // decrement remaining players
+		}
+	}
+
+	round.nextPlayer = round.winners[rng.below(round.winners.size())]; // random one of winners if multiple players assaf-ed
+	return round.nextPlayer;
+}
+
+void Yaniv::resetGame(int winner) {
+	remainingPlayers = numPlayers;
+	for (size_t i = 0; i < players.size(); i++) {
+		players[i].score = 0;
+		players[i].stillPlaying = true;
+	}
+	resetRound(winner);
+}
+
+void Yaniv::resetRound(int winner) {
+	deck = FULL_DECK;
+	shuffleCards(deck);
+	currentPlayer = winner;
+	faceUpTakes = 0;
+	discardPile.clear();
+	availableToTake.clear();
+	nextAvailableToTake.clear();
+	history.clear();
+	undoLog.clear(); // moves before a new deal can't be taken back
+	undoBytes.clear();
+	// room for every card up front so turns never have to grow them
+	discardPile.reserve(NUM_CARDS);
+	availableToTake.reserve(NUM_CARDS);
+	nextAvailableToTake.reserve(NUM_CARDS);
+	endgameDiscards.reserve(NUM_CARDS);
+
+	// clear hands and deal cards
+	for (size_t i = 0; i < players.size(); i++) {
+		players[i].clearHand();
+		players[i].cardsDrawnPublicly.clear();
+		players[i].knowledge.reset();
+		players[i].hand.reserve(NUM_CARDS);
+		players[i].cardsDrawnPublicly.reserve(NUM_CARDS);
+		dealCards(players[i], rules.cardsAtStart);
+		sortCards(players[i].hand);
+	}
+
+	// make a card available for first player to take
+	revealCard(deck.back());
+	discardPile.push_back(deck.back());
+	availableToTake.push_back(deck.back());
+	nextAvailableToTake = availableToTake;
+	deck.pop_back();
+	if (recorder) {
+		recordDeal();
+	}
+}
+
+void Yaniv::shuffleCards(vector <Card> &cards) {
+	// Fisher-Yates shuffle
+	for (int i = cards.size() - 1; i > 0; i--) {
+		swap(cards[i], cards[rng.below(i + 1)]);
+	}
+}
+
+void Yaniv::changeTurn() {
+	if (currentPlayer == numPlayers - 1) {
+		currentPlayer = 0;
+	}
+	else {
+		++currentPlayer;
+	}
+}
+
+int Yaniv::countCardInVector(const vector<Card> &v, int c, vector<Card> &discard) {
+	int count = 0, length = v.size();
+	for (int i = 0; i < length; i++) {
+		int value = getValue(v[i]);
+		if (value == c) {
+			discard.push_back(v[i]);
+			++count;
+		}
+	}
+	return count;
+}
+
+// bestDiscard gets the card to draw (NO_CARD for the draw pile) followed by the cards to discard
+template <class R>
+void Yaniv::getBestDiscard(const vector<Card> &hand, const vector<Card> &availableCards, bool takingFromDiscard, vector<Card> &bestDiscard) {
+	// with nothing to take the best discard may have been worked out ahead of time
+	// the last card is played if nothing scores more, so the table is only right for hands sorted by value
+	if (availableCards.empty() && discardTable) {
+		bool sorted = true;
+		for (size_t i = 0; i < hand.size(); i++)
+			sorted = sorted && RANK_OF[hand[i]] <= RANK_OF[hand.back()];
+		CardSet discard;
+		if (sorted && discardTable->lookup(toCardSet(hand), rules.minToCallYaniv, discard)) {
+			orderDiscards(discard, bestDiscard);
+			bestDiscard.insert(bestDiscard.begin(), NO_CARD);
+			return;
+		}
+	}
+	// without jokers every pass comes from one scan of the hand
+	CardSet handSet = toCardSet(hand);
+	bool noJokers = !(handSet & JOKER_BITS);
+	for (size_t i = 0; i < availableCards.size(); i++)
+		noJokers = noJokers && !isJoker(availableCards[i]);
+	if (noJokers) {
+		if (discardScan.cards != handSet) {
+			discardScan.scan(handSet);
+		}
+		int bestPoints = pointsForCard(hand.back());
+		Card bestDraw = NO_CARD;
+		CardSet best = 0, discard;
+		if (availableCards.empty()) {
+			if (discardScan.best(NO_CARD, true, discard) > bestPoints)
+				best = discard;
+		}
+		else {
+			bool ableToTakeFromMiddle = (R::canTakeFromMiddleOfSet(rules) && getValue(availableCards.front()) == getValue(availableCards.back()));
+			for (size_t j = 0; j < availableCards.size(); j++) {
+				if (!ableToTakeFromMiddle && j == 1) { // only the ends of the set can be taken
+					j = availableCards.size() - 1;
+				}
+				int points = discardScan.best(availableCards[j], !takingFromDiscard, discard);
+				if (points > bestPoints) {
+					bestPoints = points;
+					best = discard;
+					bestDraw = availableCards[j];
+				}
+			}
+		}
+		bestDiscard.assign(1, bestDraw);
+		if (!best) {
+			bestDiscard.push_back(hand.back());
+		}
+		for (; best; best &= best - 1)
+			bestDiscard.push_back((Card)lowestCard(best));
+		return;
+	}
+	int bestDiscardPts = pointsForCard(hand.back());
+	bestDiscard.assign(1, NO_CARD);
+	bestDiscard.push_back(hand.back());
+	Card draw = NO_CARD;
+	Card bestDraw = draw;
+	int numAvailableCards = availableCards.size();
+	if (availableCards.empty()) {
+		takingFromDiscard = false;
+		numAvailableCards = 1; // check hand alone once
+	}
+
+	bool ableToTakeFromMiddle = false;
+	// if the cards down are multiples of the same card
+	// and if can take any card when multiples are played
+	if (R::canTakeFromMiddleOfSet(rules) && availableCards.size() && getValue(availableCards.front()) == getValue(availableCards.back()) && !isJoker(availableCards.front())) {
+		ableToTakeFromMiddle = true;
+	}
+
+	int j = 0;
+
+	// do twice if available cards
+	while (j < numAvailableCards) {
+		CardSet cards = handSet;
+		// if checking available cards
+		if (availableCards.size()) {
+			if (!ableToTakeFromMiddle && j == 1) { // if done with 0 and can't take from middle
+				j = availableCards.size() - 1; // skip to last card of available cards
+			}
+			draw = availableCards[j]; // card to draw is j
+			cards |= cardBit(draw); // add draw to temporary hand
+		}
+		CardSet jokers = cards & JOKER_BITS;
+		int numJokers = countCards(jokers);
+
+		// check for multiples
+		for (int k = 0; k <= NUM_RANKS; k++) {
+			CardSet discard = (k ? cards & RANK_MASK[k] : jokers);
+			int pointsForAllOfValue = countCards(discard) * POINTS_FOR_RANK[k];
+			if (isJoker(draw)) { pointsForAllOfValue += 99; } // if can draw a joker, always do it
+			if (pointsForAllOfValue > bestDiscardPts) {
+				CardSet savedCards = cards & ~discard;
+				// if taking a card, must play more than 1 card, otherwise, 1 card is fine
+				// if picking an available card, then highest card after discarding this set should not be a Joker
+				if ((countCards(discard) > 1 && !onlyJokers(savedCards)) || (!takingFromDiscard)) {
+					bestDiscardPts = pointsForAllOfValue;
+					bestDiscard.resize(1);
+					for (; discard; discard &= discard - 1)
+						bestDiscard.push_back((Card)lowestCard(discard));
+					bestDraw = draw;
+				}
+			}
+		}
+
+		// check for series, starting from each card that's NOT a Joker (lowest values first)
+		for (int k = 1; k <= NUM_RANKS; k++) {
+			for (CardSet starts = cards & RANK_MASK[k]; starts; starts &= starts - 1) {
+				Card firstCard = (Card)lowestCard(starts);
+				int suit = SUIT_OF[firstCard];
+				int first = k - 1; // bit of first card in suit lane
+				unsigned lane = suitLane(cards, suit);
+				// gaps in the suit above the first card, jokers fill the lowest ones and the series stops at the next
+				unsigned gaps = ~lane & SUIT_LANE & (SUIT_LANE << first);
+				for (int i = 0; i < numJokers && gaps; i++)
+					gaps &= gaps - 1;
+				int end = (gaps ? lowestCard(gaps) : NUM_RANKS); // bit after the last card of the series
+				unsigned series = (unsigned)(SUIT_LANE >> (NUM_RANKS - (end - first))) << first;
+				unsigned filled = series & ~lane; // values replaced by jokers
+				// jokers count as half of the card they replace
+				int pointsForSeries = 0;
+				for (unsigned bits = series; bits; bits &= bits - 1) {
+					int value = lowestCard(bits) + 1;
+					pointsForSeries += (filled & (1u << (value - 1)) ? POINTS_FOR_RANK[value] / 2 : POINTS_FOR_RANK[value]);
+				}
+				CardSet seriesCards = (CardSet)(series & lane) << (suit * NUM_RANKS);
+				int savedPts = pointsInSet(cards & ~seriesCards);
+				int top = end - 1;
+				while (filled & (1u << top)) {
+					// if saved cards are 3 or fewer points and card before leading joker is not a joker and joker is needed as 3rd card
+					// i.e. if hand is low and using only 1 joker to get rid of a couple extra cards, keep joker on end of series
+					if (savedPts <= rules.minToCallYaniv - 4 && !(filled & (1u << (top - 1))) && countCards(series) <= 3) {
+						break;
+					}
+					series &= ~(1u << top); // don't end series with a joker
+					filled &= ~(1u << top);
+					--top;
+				}
+				int unusedJokers = numJokers - countCards(filled);
+				// if taking to make a series and highest card you can discard is a joker
+				if (unusedJokers > 0 && !(cards & SUITED_BITS & ~seriesCards) && availableCards.size() && !isJoker(draw)) {
+					continue; // don't discard joker to make series
+				}
+				if (countCards(series) >= 3) {
+					if (isJoker(draw)) { pointsForSeries += 99; } // if can draw a joker, always do it
+					if (pointsForSeries > bestDiscardPts) {
+						bestDiscardPts = pointsForSeries;
+						bestDiscard.resize(1);
+						CardSet unused = jokers;
+						for (int value = k; value <= top + 1; value++) {
+							if (filled & (1u << (value - 1))) {
+								bestDiscard.push_back((Card)lowestCard(unused)); // lowest joker first
+								unused &= unused - 1;
+							}
+							else {
+								bestDiscard.push_back(makeCard(value, suit));
+							}
+						}
+						bestDraw = draw;
+					}
+				}
+			}
+		}
+
+		// if not checking available cards break after 1 pass
+		if (availableCards.empty()) {
+			break;
+		}
+
+		++j;
+	}
+
+	bestDiscard[0] = bestDraw;
+}
+
+// works out the best discard of every hand in the table with getBestDiscard
+void DiscardTable::generate(int rulesMinToCallYaniv) {
+	unload();
+	Yaniv game;
+	game.rules.minToCallYaniv = rulesMinToCallYaniv;
+	generated.resize(size());
+	vector <Card> hand, best;
+	long long i = 0;
+	for (int k = 1; k <= DISCARD_TABLE_CARDS; k++) {
+		// every set of k cards in increasing order (the next bigger number with k bits set)
+		for (CardSet set = (1ULL << k) - 1; set < (1ULL << NUM_CARDS); i++) {
+			hand.clear();
+			for (CardSet cards = set; cards; cards &= cards - 1)
+				hand.push_back((Card)lowestCard(cards));
+			game.sortCards(hand);
+			game.getBestDiscard(hand, NO_CARDS, true, best);
+			CardSet discard = toCardSet(vector <Card>(best.begin() + 1, best.end()));
+			unsigned char played = 0;
+			int bit = 0;
+			for (CardSet cards = set; cards; cards &= cards - 1, bit++) {
+				if (discard & cardBit((Card)lowestCard(cards)))
+					played |= 1 << bit;
+			}
+			generated[i] = played;
+			CardSet low = set & (0 - set);
+			CardSet ripple = set + low;
+			set = ripple | (((ripple ^ set) >> 2) / low);
+		}
+	}
+	entries = generated.data();
+	minToCallYaniv = rulesMinToCallYaniv;
+}
+
+string cardToString(Card card) {
+	if (isJoker(card)) { return "J"; }
+	return RANK_NAMES[RANK_OF[card]] + SUIT_CHARS[SUIT_OF[card]];
+}
+
+bool parseCard(string str, Card &card) {
+	// Joker is just "J", all other cards are a value followed by a suit (ex. "10C")
+	if (str == "J") {
+		card = JOKER_1;
+		return true;
+	}
+	if (str.length() < 2) { return false; }
+	string value = str.substr(0, str.length() - 1);
+	const char *suit = find(SUIT_CHARS, SUIT_CHARS + 4, str.back());
+	if (suit == SUIT_CHARS + 4) { return false; }
+	for (int rank = 1; rank <= NUM_RANKS; rank++) {
+		if (RANK_NAMES[rank] == value) {
+			card = makeCard(rank, suit - SUIT_CHARS);
+			return true;
+		}
+	}
+	return false;
+}
+
+void SimulationStats::add(const GameResult &result) {
+	if (wins.size() <= (size_t)result.winner)
+		wins.resize(result.winner + 1, 0);
+	++games;
+	++wins[result.winner];
+	rounds += result.rounds;
+	turns += result.turns;
+	assafs += result.assafs.size();
+	stalledRounds += result.stalledRounds;
+	decisionMs.insert(decisionMs.end(), result.decisionMs.begin(), result.decisionMs.end());
+	if (result.turns > longestTurns) {
+		longestTurns = result.turns;
+		longestSeed = result.seed;
+	}
+}
+
+void SimulationStats::merge(const SimulationStats &other) {
+	if (wins.size() < other.wins.size())
+		wins.resize(other.wins.size(), 0);
+	for (size_t i = 0; i < other.wins.size(); i++)
+		wins[i] += other.wins[i];
+	games += other.games;
+	rounds += other.rounds;
+	turns += other.turns;
+	assafs += other.assafs;
+	stalledRounds += other.stalledRounds;
+	decisionMs.insert(decisionMs.end(), other.decisionMs.begin(), other.decisionMs.end());
+	if (other.longestTurns > longestTurns) {
+		longestTurns = other.longestTurns;
+		longestSeed = other.longestSeed;
+	}
+}
+
+bool RecordStats::sameRules(const GameRecordHeader &header) const {
+	return header.players == rules.players && header.cardsAtStart == rules.cardsAtStart && header.minToCallYaniv == rules.minToCallYaniv && header.variations == rules.variations
+		&& header.assafPenalty == rules.assafPenalty && header.extraAssafPenalties == rules.extraAssafPenalties && header.pointsLimit == rules.pointsLimit;
+}
+
+// goes through the events of one recorded game (see RecordEvent), the cards themselves are skipped over
+void RecordStats::add(const GameRecordHeader &header, const unsigned char *events) {
+	int numPlayers = header.players, turnsInRound = 0;
+	CardSet stillIn = (1ULL << numPlayers) - 1;
+	const unsigned char *event = events, *end = events + header.bytes;
+	while (event < end) {
+		int type = *event & 0xE0;
+		if (type == EVENT_DEAL) {
+			if (turnsInRound) { ++stalledRounds; } // the last round didn't end with a Yaniv call
+			turnsInRound = 0;
+			++event;
+			for (int i = 0; i < numPlayers; i++)
+				event += 1 + *event;
+			++event;
+		}
+		else if (type == EVENT_TURN) {
+			++turnsInRound;
+			event += 3 + (event[1] & 31);
+		}
+		else if (type == EVENT_YANIV) {
+			int cards = min((int)event[2], RECORD_HAND_SIZES - 1);
+			bool assafed = event[3] != 0;
+			++rounds;
+			turns += turnsInRound + 1;
+			turnsInRound = 0;
+			++calls[cards];
+			assafs += assafed;
+			assafsBy[cards] += assafed;
+			event += 4;
+		}
+		else if (type == EVENT_SNAPSHOT) {
+			event += 3 + (event[1] | event[2] << 8);
+		}
+		else if (type == EVENT_SCORES) {
+			roundScores += countCards(stillIn);
+			reducedScores += countCards(event[1]);
+			stillIn &= ~(CardSet)event[2];
+			event += 3 + 2 * numPlayers;
+		}
+		else { // EVENT_END
+			++games;
+			return;
+		}
+	}
+}
+
+void RecordStats::merge(const RecordStats &other) {
+	games += other.games;
+	rounds += other.rounds;
+	turns += other.turns;
+	stalledRounds += other.stalledRounds;
+	assafs += other.assafs;
+	roundScores += other.roundScores;
+	reducedScores += other.reducedScores;
+	for (int i = 0; i < RECORD_HAND_SIZES; i++) {
+		calls[i] += other.calls[i];
+		assafsBy[i] += other.assafsBy[i];
+	}
+}
+
+// if a game read back from a record file has the seed, rules, turns, Yaniv calls, Assafs, scores and winner it was played with
+bool recordMatches(const GameRecordHeader &header, const unsigned char *events, const Rules &rules, int numPlayers, const GameResult &result) {
+	Rules recorded = recordedRules(header);
+	if (header.seed != result.seed || header.players != numPlayers || recorded.cardsAtStart != rules.cardsAtStart || recorded.minToCallYaniv != rules.minToCallYaniv
+		|| recorded.assafPenalty != rules.assafPenalty || recorded.extraAssafPenalties != rules.extraAssafPenalties || recorded.pointsLimit != rules.pointsLimit
+		|| recorded.canSlapdown != rules.canSlapdown || recorded.canSwapJoker != rules.canSwapJoker
+		|| recorded.canTakeFromMiddleOfSet != rules.canTakeFromMiddleOfSet || recorded.reductionIsHalf != rules.reductionIsHalf) {
+		return false;
+	}
+	const unsigned char *event = events, *end = events + header.bytes;
+	size_t rounds = 0, assafs = 0;
+	int turns = 0;
+	while (event < end) {
+		int type = *event & 0xE0, low = *event & 31;
+		if (type == EVENT_DEAL) {
+			++event;
+			for (int i = 0; i < numPlayers; i++)
+				event += 1 + *event;
+			++event;
+		}
+		else if (type == EVENT_TURN) {
+			++turns;
+			event += 3 + (event[1] & 31);
+		}
+		else if (type == EVENT_YANIV) {
+			++turns;
+			++rounds;
+			int assafers = 0;
+			if (assafs < result.assafs.size() && result.assafs[assafs].round == (int)rounds) {
+				const AssafEvent &assaf = result.assafs[assafs++];
+				if (assaf.caller != low || assaf.callerPoints != event[1]) { return false; }
+				for (size_t i = 0; i < assaf.assafers.size(); i++)
+					assafers |= 1 << assaf.assafers[i];
+			}
+			if (event[3] != assafers) { return false; }
+			event += 4;
+		}
+		else if (type == EVENT_SCORES) {
+			if (!rounds || rounds > result.roundScores.size()) { return false; }
+			for (int i = 0; i < numPlayers; i++) {
+				if ((event[3 + 2 * i] | event[4 + 2 * i] << 8) != result.roundScores[rounds - 1][i]) { return false; }
+			}
+			event += 3 + 2 * numPlayers;
+		}
+		else if (type == EVENT_SNAPSHOT) {
+			event += 3 + (event[1] | event[2] << 8);
+		}
+		else { // EVENT_END
+			return low == result.winner && event + 1 == end && turns == result.turns && rounds == result.roundScores.size() && assafs == result.assafs.size();
+		}
+	}
+	return false;
+}
+
+// range of work owned by one thread, other threads steal from its end
+struct WorkRange {
+	mutex lock;
+	long long next = 0;
+	long long end = 0;
+};
+
+void parallelFor(long long count, int numThreads, long long chunkSize, function<void(int, long long, long long)> work, vector <long long> *steals) {
+	// give each thread an equal share, threads take chunks from the front of their own share
+	vector <WorkRange> ranges(numThreads);
+	for (int i = 0; i < numThreads; i++) {
+		ranges[i].next = count * i / numThreads;
+		ranges[i].end = count * (i + 1) / numThreads;
+	}
+	if (steals)
+		steals->assign(numThreads, 0);
+
+	auto worker = [&](int id) {
+		WorkRange &own = ranges[id];
+		while (true) {
+			long long begin = 0, end = 0;
+			{
+				lock_guard<mutex> guard(own.lock);
+				if (own.next < own.end) {
+					begin = own.next;
+					end = min(own.next + chunkSize, own.end);
+					own.next = end;
+				}
+			}
+			if (begin == end) {
+				// out of work: steal the back half of the largest remaining share
+				int victim = -1;
+				long long mostLeft = 0;
+				for (int i = 0; i < numThreads; i++) {
+					if (i == id) { continue; }
+					lock_guard<mutex> guard(ranges[i].lock);
+					if (ranges[i].end - ranges[i].next > mostLeft) {
+						mostLeft = ranges[i].end - ranges[i].next;
+						victim = i;
+					}
+				}
+				if (victim < 0) { return; } // no work left anywhere
+				long long stolenBegin, stolenEnd;
+				{
+					lock_guard<mutex> guard(ranges[victim].lock);
+					stolenEnd = ranges[victim].end;
+					stolenBegin = ranges[victim].next + (stolenEnd - ranges[victim].next) / 2;
+					ranges[victim].end = stolenBegin;
+				}
+				if (stolenBegin == stolenEnd) { continue; } // victim finished first, look again
+				{
+					lock_guard<mutex> guard(own.lock);
+					own.next = stolenBegin;
+					own.end = stolenEnd;
+				}
+				if (steals)
+					++(*steals)[id];
+				continue;
+			}
+			work(id, begin, end);
+		}
+	};
+
+	vector <thread> threads;
+	for (int i = 1; i < numThreads; i++)
+		threads.push_back(thread(worker, i));
+	worker(0);
+	for (size_t i = 0; i < threads.size(); i++)
+		threads[i].join();
 }
 
-int Yaniv::pointsForCard(string card) {
-	string value = getValue(card);
-	if (value == "") { // Joker is only 1 char, so substring will be "". (Joker adds 0)
-		return 0;
+void setUpGame(Yaniv &game, const SimulationOptions &options) {
+	// AIs with the options' rules, the first searchPlayers of them search
+	game.rules = options.rules;
+	game.searchThreads = options.searchThreads;
+	game.discardTable = options.discardTable;
+	game.makeAIPlayers(options.players);
+	for (int i = 0; i < options.searchPlayers && i < options.players; i++) {
+		game.players[i].playouts = options.playouts;
+		game.players[i].budget = options.budget;
 	}
-	if (value == "10" || value == "J" || value == "Q" || value == "K") {
-		return 10;
+}
+
+// one record file per worker thread so threads never wait on each other to write, every recorder is NULL if games aren't recorded
+bool openRecorders(const SimulationOptions &options, int numThreads, vector <RecordWriter*> &recorders) {
+	recorders.assign(numThreads, NULL);
+	if (options.record.empty()) {
+		return true;
 	}
-	else if (value == "A") {
-		return 1;
+	if (!recordFits(options.rules)) {
+		cerr << "These rules don't fit in a game record (its header keeps the penalties and limit in 2 bytes, the rest in 1), not recording." << endl;
+		return false;
 	}
-	else if (value.at(0) <= '9') {
-		return (value.at(0) - '0');
+	for (int i = 0; i < numThreads; i++) {
+		string path = options.record + "." + to_string(i);
+		recorders[i] = new RecordWriter;
+		if (!recorders[i]->open(path)) {
+			cerr << "Can't record games to " << path << " (it can't be written or is from another version), not recording." << endl;
+			for (int j = 0; j <= i; j++)
+				delete recorders[j];
+			recorders.assign(numThreads, NULL);
+			return false;
+		}
 	}
-	return -1; // should never happen
+	return true;
 }
 
-int Yaniv::countPoints(vector <string> hand) {
-	int sum = 0;
-	for (size_t i = 0; i < hand.size(); i++) {
-		sum += pointsForCard(hand[i]);
+SimulationStats simulateGames(const SimulationOptions &options, int numThreads, vector <long long> *steals) {
+	// every thread plays its own games with its own Yaniv instance, game i is seeded with firstSeed + i
+	vector <SimulationStats> threadStats(numThreads);
+	vector <Yaniv*> games(numThreads, NULL);
+	vector <RecordWriter*> recorders;
+	openRecorders(options, numThreads, recorders);
+
+	// games with search AIs are slow, so hand them out one at a time
+	parallelFor(options.games, numThreads, (options.searchPlayers ? 1 : 64), [&](int id, long long begin, long long end) {
+		if (!games[id]) {
+			games[id] = new Yaniv;
+			setUpGame(*games[id], options);
+			games[id]->recorder = recorders[id];
+		}
+		Yaniv &game = *games[id];
+		SimulationStats chunkStats; // merged once per chunk so threads don't write next to each other
+		for (long long i = begin; i < end; i++) {
+			game.startGame(options.firstSeed + i);
+			chunkStats.add(game.simulateGame(options.runtimeRules));
+		}
+		threadStats[id].merge(chunkStats);
+	}, steals);
+
+	SimulationStats total;
+	total.wins.assign(options.players, 0);
+	for (int i = 0; i < numThreads; i++) {
+		total.merge(threadStats[i]);
+		delete games[i];
+		delete recorders[i];
 	}
-	return sum;
+	return total;
 }
 
-int Yaniv::callYaniv(Player &activePlayer, int activePlayerPoints) {
-	int lowestPts = activePlayerPoints;
-	activePlayer.pointsInRound = activePlayerPoints;
-	int winner = currentPlayer;
-	vector <int> winners = {};
-
-	cout << endl << activePlayer.name << "'s hand: ";
-	cout << "(" << activePlayerPoints << " point" << (activePlayerPoints != 1 ? "s) " : ") ");
-	printVector(activePlayer.hand);
+int runSimulation(const SimulationOptions &options) {
+	long long numGames = options.games;
+	int numPlayers = options.players, numThreads = options.threads;
+	unsigned long long firstSeed = options.firstSeed;
+	if (numPlayers < MIN_PLAYERS || numPlayers > MAX_PLAYERS) {
+		cout << "The number of players must be between " << MIN_PLAYERS << " and " << MAX_PLAYERS << "." << endl;
+		return 1;
+	}
 
-	for (size_t i = 0; i < players.size(); i++) {
-		if ((i != currentPlayer) && (players[i].stillPlaying)) {
-			players[i].pointsInRound = countPoints(players[i].hand);
-			cout << players[i].name << "'s hand: ";
-			cout << "(" << players[i].pointsInRound << " point" << (activePlayerPoints != 1 ? "s) " : ") ");
-			printVector(players[i].hand);
-			if (players[i].pointsInRound <= lowestPts) {
-				lowestPts = players[i].pointsInRound;
-				winner = i;
-			}
+	// a single game prints its rounds so it can be looked at again from its seed
+	if (numGames == 1) {
+		Yaniv game;
+		setUpGame(game, options);
+		game.startGame(firstSeed);
+		GameResult result = game.simulateGame(options.runtimeRules);
+		cout << "Game " << result.seed << ": " << result.rounds << " rounds, " << result.turns << " turns, winner " << game.players[result.winner].name << "." << endl;
+		for (size_t i = 0; i < result.roundScores.size(); i++) {
+			cout << "Round " << (i + 1) << ":";
+			for (size_t j = 0; j < result.roundScores[i].size(); j++)
+				cout << " " << result.roundScores[i][j];
+			cout << endl;
+		}
+		for (size_t i = 0; i < result.assafs.size(); i++) {
+			cout << "Round " << result.assafs[i].round << ": " << game.players[result.assafs[i].caller].name << " called Yaniv with " << result.assafs[i].callerPoints << " and was Assaf-ed by " << game.players[result.assafs[i].assafers.front()].name << "." << endl;
 		}
+		return 0;
 	}
 
-	players[winner].pointsInRound = 0; // winner gets 0 for round
-	winners.push_back(winner); // add winner to potential players who can start next round (if only winner, they will start next round)
+	vector <long long> steals;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	SimulationStats stats = simulateGames(options, numThreads, &steals);
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
 
-	// if active player was Assaf-ed, print Assaf-ers and deduct penalty
-	if (winner != currentPlayer) {
-		cout << players[currentPlayer].name << " was Assaf-ed by " << players[winner].name;
-		activePlayer.score += ASSAF_PENALTY; // penalty
+	cout << "Simulated " << stats.games << " games with " << numPlayers << " AIs on " << numThreads << " thread" << (numThreads != 1 ? "s" : "") << " in " << seconds << " s (" << stats.games / seconds << " games/sec)." << endl;
+	for (int i = 0; i < numPlayers; i++) {
+		cout << "AI " << (i + 1) << ": " << stats.wins[i] << " wins (" << 100.0 * stats.wins[i] / stats.games << "%)" << endl;
+	}
+	cout << "Rounds per game: " << (double)stats.rounds / stats.games << endl;
+	cout << "Turns per game: " << (double)stats.turns / stats.games << endl;
+	cout << "Assafs per round: " << (double)stats.assafs / stats.rounds << endl;
+	cout << "Stalled rounds redealt: " << stats.stalledRounds << endl;
+	if (stats.decisionMs.size()) {
+		vector <float> &times = stats.decisionMs;
+		sort(times.begin(), times.end());
+		cout << "Search decision latency: p50 " << times[times.size() / 2] << " ms, p99 " << times[times.size() * 99 / 100] << " ms, max " << times.back() << " ms (" << times.size() << " decisions)" << endl;
+	}
+	cout << "Seeds: " << firstSeed << " to " << firstSeed + numGames - 1 << " (longest game: " << stats.longestSeed << ", " << stats.longestTurns << " turns)" << endl;
+	long long totalSteals = 0;
+	for (size_t i = 0; i < steals.size(); i++)
+		totalSteals += steals[i];
+	cout << "Work steals: " << totalSteals << endl;
 
-		// check if assaf was a tie
-		for (size_t i = 0; i < players.size(); i++) {
-			if (i != currentPlayer && i != winner && players[i].stillPlaying) { // if not caller of yaniv or declared winner with assaf
-				// if playing with extra penalties, usually 20 extra points are deducted for additional Assafs
-				if (players[i].pointsInRound <= activePlayerPoints) {
-					cout << " and " << players[i].name; // add name to assaf list
-					activePlayer.score += EXTRA_ASSAF_PENALTIES; // default is 0, but some variations add 20 points here
-				}
-				if (players[i].pointsInRound == lowestPts) { // if player has same amount as winner with assaf
-					players[i].pointsInRound = 0; // also gets 0 for round
-					winners.push_back(i); // give potential for this player to be first player next round
-				}
-			}
+	// run again on 1, 2, 4, ... threads to see how well games spread across cores
+	if (options.scaling) {
+		cout << endl << "SCALING (" << thread::hardware_concurrency() << " hardware threads):" << endl;
+		double baseRate = 0;
+		for (int threads = 1; threads <= numThreads; threads = (threads * 2 <= numThreads || threads == numThreads ? threads * 2 : numThreads)) {
+			start = chrono::steady_clock::now();
+			SimulationOptions unrecorded = options;
+			unrecorded.record.clear(); // the games were recorded by the first run
+			SimulationStats run = simulateGames(unrecorded, threads);
+			double rate = run.games / chrono::duration<double>(chrono::steady_clock::now() - start).count();
+			if (threads == 1) { baseRate = rate; }
+			cout << threads << " thread" << (threads != 1 ? "s: " : ": ") << rate << " games/sec, speedup " << rate / baseRate << "x, efficiency " << 100.0 * rate / baseRate / threads << "%" << endl;
 		}
-
-		cout << "." << endl;
 	}
+	return 0;
+}
 
-	// print winners
-	cout << players[winners.front()].name << " ";
-	for (size_t i = 1; i < winners.size(); i++)
-		cout << "and " << players[winners[i]].name << " ";
-	cout << "won the round." << endl;
-
-	cout << endl << "SCOREBOARD:" << endl;
+int runSweep(const SimulationOptions &options) {
+	if (options.players < MIN_PLAYERS || options.players > MAX_PLAYERS) {
+		cout << "The number of players must be between " << MIN_PLAYERS << " and " << MAX_PLAYERS << "." << endl;
+		return 1;
+	}
+	// every combination of the rule variations, numbers are kept from the options
+	vector <Rules> variations;
+	for (int i = 0; i < 16; i++) {
+		Rules rules = options.rules;
+		rules.canSlapdown = !(i & 8);
+		rules.canSwapJoker = !(i & 4);
+		rules.canTakeFromMiddleOfSet = !(i & 2);
+		rules.reductionIsHalf = !(i & 1);
+		variations.push_back(rules);
+	}
 
-	for (size_t i = 0; i < players.size(); i++) {
-		bool scoreHalved = false;
-		players[i].score += players[i].pointsInRound;
-		// if score is divisible by 50 and score increased (i.e. 50, 100, 150, 200), halve score
-		if (players[i].pointsInRound > 0 && players[i].score % 50 == 0) {
-			if (REDUCTION_IS_HALF) { players[i].score /= 2; } // if true, halve score
-			else { players[i].score -= 50; } // if false, deduct 50
-			scoreHalved = true;
+	// all variations are played at once, game i of every variation uses the same seed
+	long long numGames = options.games;
+	vector <vector <SimulationStats> > threadStats(options.threads, vector <SimulationStats>(variations.size()));
+	vector <Yaniv*> games(options.threads, NULL);
+	vector <RecordWriter*> recorders;
+	openRecorders(options, options.threads, recorders);
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	parallelFor(numGames * variations.size(), options.threads, 64, [&](int id, long long begin, long long end) {
+		if (!games[id]) {
+			games[id] = new Yaniv;
+			setUpGame(*games[id], options);
+			games[id]->recorder = recorders[id];
 		}
-		// print player's name and score
-		cout << players[i].name << ": " << players[i].score << " point" << (players[i].score != 1 ? "s" : "");
-		// add message if score was halved
-		if (scoreHalved) {
-			cout << " -- " << players[i].name << (REDUCTION_IS_HALF ? "'s score was halved!" : "'s score was deducted by 50!");
+		Yaniv &game = *games[id];
+		for (long long i = begin; i < end; i++) {
+			game.rules = variations[i / numGames];
+			game.startGame(options.firstSeed + i % numGames);
+			threadStats[id][i / numGames].add(game.simulateGame());
 		}
-		// knock players out of round if hit max
-		if (players[i].score > POINTS_LIMIT) {
-			cout << " -- OUT";
-			if (players[i].stillPlaying) {
-				players[i].pointsInRound = 0;
-				players[i].stillPlaying = false; // will be skipped in future rounds
-				--remainingPlayers; // decrement remaining players
-			}
+	});
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	cout << "Simulated " << numGames << " games of each of " << variations.size() << " rule variations with " << options.players << " AIs in " << seconds << " s (" << numGames * variations.size() / seconds << " games/sec)." << endl;
+	cout << "Slapdown Swap-Joker Middle-Take Halving | Rounds/game Turns/game Assafs/round Stalled" << endl;
+	for (size_t v = 0; v < variations.size(); v++) {
+		SimulationStats stats;
+		for (int i = 0; i < options.threads; i++)
+			stats.merge(threadStats[i][v]);
+		cout << (variations[v].canSlapdown ? "Y" : "N") << "        " << (variations[v].canSwapJoker ? "Y" : "N") << "          " << (variations[v].canTakeFromMiddleOfSet ? "Y" : "N") << "           " << (variations[v].reductionIsHalf ? "Y" : "N") << "       | ";
+		cout << (double)stats.rounds / stats.games << " " << (double)stats.turns / stats.games << " " << (double)stats.assafs / stats.rounds << " " << stats.stalledRounds << endl;
+	}
+	for (int i = 0; i < options.threads; i++) {
+		delete games[i];
+		delete recorders[i];
+	}
+	return 0;
+}
+
+int compareEngines(const SimulationOptions &options) {
+	if (options.players < MIN_PLAYERS || options.players > MAX_PLAYERS) {
+		cout << "The number of players must be between " << MIN_PLAYERS << " and " << MAX_PLAYERS << "." << endl;
+		return 1;
+	}
+	// same seeds on both engines, alternating so neither always runs on a warm cache
+	double seconds[2] = { 0, 0 };
+	SimulationStats stats[2];
+	for (int pass = 0; pass < 4; pass++) {
+		for (int runtimeChecked = 0; runtimeChecked < 2; runtimeChecked++) {
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+			SimulationOptions run = options;
+			run.runtimeRules = (runtimeChecked == 1);
+			run.record.clear(); // the same games are played 8 times
+			stats[runtimeChecked] = simulateGames(run, options.threads);
+			seconds[runtimeChecked] += chrono::duration<double>(chrono::steady_clock::now() - start).count();
 		}
-		cout << endl;
 	}
-	cout << endl;
+	double compiled = 4 * options.games / seconds[0], runtime = 4 * options.games / seconds[1];
+	bool same = stats[0].turns == stats[1].turns && stats[0].rounds == stats[1].rounds && stats[0].wins == stats[1].wins;
+	cout << "Compiled rules: " << compiled << " games/sec" << endl;
+	cout << "Runtime rules: " << runtime << " games/sec" << endl;
+	cout << "Speedup: " << compiled / runtime << "x, results " << (same ? "identical" : "DIFFER") << endl;
+	return (same ? 0 : 1);
+}
 
-	return winners[rand() % winners.size()]; // return random one of winners if multiple players assaf-ed
+BenchResult timeBenchmark(string name, long long ops, function<long long()> work) {
+	// best of several runs, the checksum keeps the compiler from dropping the work
+	static volatile long long checksum = 0;
+	BenchResult result;
+	result.name = name;
+	result.ops = ops;
+	result.nsPerOp = numeric_limits<double>::max();
+	for (int run = 0; run < 5; run++) {
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		checksum += work();
+		double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+		result.nsPerOp = min(result.nsPerOp, ns / ops);
+	}
+	return result;
 }
 
-void Yaniv::resetGame(int winner) {
-	remainingPlayers = numPlayers;
-	for (size_t i = 0; i < players.size(); i++) {
-		players[i].score = 0;
-		players[i].stillPlaying = true;
+int generateTable(const SimulationOptions &options) {
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	DiscardTable table;
+	table.generate(options.rules.minToCallYaniv);
+	if (!table.save(options.genTable)) {
+		cout << "Couldn't write " << options.genTable << "." << endl;
+		return 1;
 	}
-	resetRound(winner);
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	cout << "Wrote the best discards of " << DiscardTable::size() << " hands to " << options.genTable << " in " << seconds << " s." << endl;
+	return 0;
 }
 
-void Yaniv::resetRound(int winner) {
-	deck = FULL_DECK;
-	std::random_shuffle(deck.begin(), deck.end());
-	currentPlayer = winner;
-	discardPile.clear();
-	availableToTake.clear();
-	nextAvailableToTake.clear();
-	history.clear();
+// the files --record wrote to (path.0, path.1, ...) or the file path, false if there are none of this version
+bool loadRecordFiles(const string &path, vector <RecordFile*> &files) {
+	for (int i = 0; ; i++) {
+		RecordFile *file = new RecordFile;
+		if (!file->load(path + "." + to_string(i)) && !(i == 0 && file->load(path))) {
+			delete file;
+			break;
+		}
+		files.push_back(file);
+		if (i == 0 && !ifstream(path + ".0")) { break; } // a single file
+	}
+	if (files.empty()) {
+		cout << "No game records of this version in " << path << " or " << path << ".0." << endl;
+		return false;
+	}
+	return true;
+}
 
-	// clear hands and deal cards
-	for (size_t i = 0; i < players.size(); i++) {
-		players[i].hand.clear();
-		players[i].cardsDrawnPublicly.clear();
-		dealCards(players[i], CARDS_AT_START);
-		sortCards(players[i].hand);
+// reads the games --record wrote on every thread and reports how Yaniv calls, Assafs and scores went under each set of rules
+int analyzeRecords(const SimulationOptions &options) {
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	vector <RecordFile*> files;
+	if (!loadRecordFiles(options.analyze, files)) {
+		return 1;
 	}
 
-	// make a card available for first player to take
-	int cardNum = rand() % deck.size();
-	discardPile.push_back(deck[cardNum]);
-	availableToTake.push_back(deck[cardNum]);
-	nextAvailableToTake = availableToTake;
-	deck.erase(deck.begin() + cardNum);
+	// the blocks of every file (found by load) are shared out between the threads, which go from game to game inside them
+	vector <pair <const RecordFile*, size_t> > blocks;
+	size_t bytes = 0;
+	for (size_t i = 0; i < files.size(); i++) {
+		for (size_t j = 0; j < files[i]->blockStarts.size(); j++)
+			blocks.push_back(make_pair(files[i], j));
+		bytes += files[i]->size;
+	}
+	vector <vector <RecordStats> > threadStats(options.threads);
+	parallelFor(blocks.size(), options.threads, 1, [&](int id, long long begin, long long end) {
+		vector <RecordStats> &stats = threadStats[id];
+		GameRecordHeader header;
+		const unsigned char *events;
+		size_t rules = 0; // games next to each other usually have the same rules
+		for (long long i = begin; i < end; i++) {
+			const RecordFile &file = *blocks[i].first;
+			size_t offset = file.blockStarts[blocks[i].second], blockEnd = file.blockEnds[blocks[i].second];
+			while (offset < blockEnd && file.nextGame(offset, header, events)) {
+				if (rules >= stats.size() || !stats[rules].sameRules(header)) {
+					for (rules = 0; rules < stats.size() && !stats[rules].sameRules(header); rules++) {}
+					if (rules == stats.size()) {
+						stats.push_back(RecordStats());
+						stats.back().rules = header;
+					}
+				}
+				stats[rules].add(header, events);
+			}
+		}
+	});
+	vector <RecordStats> total;
+	for (int id = 0; id < options.threads; id++) {
+		for (size_t i = 0; i < threadStats[id].size(); i++) {
+			size_t rules = 0;
+			while (rules < total.size() && !total[rules].sameRules(threadStats[id][i].rules))
+				++rules;
+			if (rules == total.size()) {
+				total.push_back(threadStats[id][i]);
+			}
+			else {
+				total[rules].merge(threadStats[id][i]);
+			}
+		}
+	}
+	// same order as --sweep, variations with every rule first
+	sort(total.begin(), total.end(), [](const RecordStats &a, const RecordStats &b) {
+		const GameRecordHeader &x = a.rules, &y = b.rules;
+		return tie(x.players, y.variations, x.cardsAtStart, x.minToCallYaniv, x.assafPenalty, x.extraAssafPenalties, x.pointsLimit)
+			< tie(y.players, x.variations, y.cardsAtStart, y.minToCallYaniv, y.assafPenalty, y.extraAssafPenalties, y.pointsLimit);
+	});
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	long long games = 0;
+	for (size_t i = 0; i < total.size(); i++)
+		games += total[i].games;
+
+	cout << "Read " << games << " games (" << bytes / 1e6 << " MB) from " << files.size() << " file" << (files.size() != 1 ? "s" : "") << " on " << options.threads << " thread" << (options.threads != 1 ? "s" : "") << " in " << seconds << " s (" << bytes / 1e6 / seconds << " MB/s)." << endl;
+	for (size_t i = 0; i < total.size(); i++) {
+		const RecordStats &stats = total[i];
+		const GameRecordHeader &rules = stats.rules;
+		bool half = rules.variations & 1;
+		cout << endl << (int)rules.players << " players, " << (int)rules.cardsAtStart << " cards, Yaniv at " << (int)rules.minToCallYaniv << ", Assaf penalty " << rules.assafPenalty << " (+" << rules.extraAssafPenalties << " per extra Assaf), limit " << rules.pointsLimit;
+		cout << ", slapdown " << (rules.variations & 8 ? "Y" : "N") << ", swap joker " << (rules.variations & 4 ? "Y" : "N") << ", middle take " << (rules.variations & 2 ? "Y" : "N") << ", halving " << (half ? "Y" : "N") << endl;
+		cout << "Games: " << stats.games << ", rounds per game: " << (double)stats.rounds / stats.games << ", turns per round: " << (double)stats.turns / stats.rounds << ", stalled rounds redealt: " << stats.stalledRounds << endl;
+		cout << "Yaniv calls not Assaf-ed: " << 100.0 * (stats.rounds - stats.assafs) / stats.rounds << "%" << endl;
+		cout << "Scores " << (half ? "halved" : "deducted 50") << ": " << 100.0 * stats.reducedScores / stats.roundScores << "% of round scores (" << (double)stats.reducedScores / stats.rounds << " per round)" << endl;
+		cout << "Assaf-ed by cards in the caller's hand:";
+		const char *separator = " ";
+		for (int cards = 0; cards < RECORD_HAND_SIZES; cards++) {
+			if (stats.calls[cards]) {
+				cout << separator << cards << (cards == RECORD_HAND_SIZES - 1 ? "+" : "") << ": " << 100.0 * stats.assafsBy[cards] / stats.calls[cards] << "% of " << stats.calls[cards];
+				separator = ", ";
+			}
+		}
+		cout << endl;
+	}
+	for (size_t i = 0; i < files.size(); i++)
+		delete files[i];
+	return 0;
 }
 
-void Yaniv::changeTurn() {
-	if (currentPlayer == numPlayers - 1) {
-		currentPlayer = 0;
+// rebuilds one recorded game at a turn and makes that turn's decision again, to look at (or profile) a single decision
+int replayRecord(const SimulationOptions &options) {
+	vector <RecordFile*> files;
+	if (!loadRecordFiles(options.replay, files)) {
+		return 1;
 	}
-	else {
-		++currentPlayer;
+	// the game with the seed, played with the options' rule variations if the file has more than one (like --sweep records)
+	GameRecordHeader header, found;
+	const unsigned char *events, *foundEvents = NULL;
+	int variations = options.rules.canSlapdown << 3 | options.rules.canSwapJoker << 2 | options.rules.canTakeFromMiddleOfSet << 1 | options.rules.reductionIsHalf;
+	for (size_t i = 0; i < files.size(); i++) {
+		size_t offset = 0;
+		while (files[i]->nextGame(offset, header, events)) {
+			if (header.seed == options.replayGame && (!foundEvents || (found.variations != variations && header.variations == variations))) {
+				found = header;
+				foundEvents = events;
+			}
+		}
+	}
+	if (!foundEvents) {
+		cout << "No game with seed " << options.replayGame << " in " << options.replay << "." << endl;
+		return 1;
+	}
+	SimulationOptions run = options;
+	run.players = found.players;
+	run.rules = recordedRules(found);
+	Yaniv game;
+	setUpGame(game, run);
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	int from = game.replay(found, foundEvents, options.replayTurn);
+	double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+	if (from < 0) {
+		cout << "Game " << found.seed << " ends before turn " << options.replayTurn << " or was recorded by a different engine." << endl;
+		return 1;
+	}
+	cout << "Game " << found.seed << ", turn " << options.replayTurn << ": rebuilt from " << (from ? "the snapshot at turn " + to_string(from) : string("the deal")) << " in " << ms << " ms." << endl;
+	for (size_t i = 0; i < game.players.size(); i++) {
+		const Player &player = game.players[i];
+		cout << player.name << ": " << player.score << " point" << (player.score != 1 ? "s" : "");
+		if (!player.stillPlaying) {
+			cout << " -- OUT" << endl;
+			continue;
+		}
+		cout << ", hand (" << player.handPoints << " point" << (player.handPoints != 1 ? "s" : "") << "): ";
+		game.printVector(player.hand);
 	}
+	cout << "Face up: ";
+	game.printVector(game.availableToTake);
+	cout << "Draw pile: " << game.deck.size() << " cards, discard pile: " << game.discardPile.size() << " cards" << endl;
+
+	// the same random numbers as when the game was played, so heuristic AIs make the same decision
+	Player &activePlayer = game.players[game.currentPlayer];
+	Move move;
+	start = chrono::steady_clock::now();
+	bool callsYaniv = game.decideTurn(activePlayer, move);
+	ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+	cout << activePlayer.name << (callsYaniv ? " calls Yaniv" : " discards ");
+	if (!callsYaniv) {
+		for (size_t i = 0; i < move.discards.size(); i++)
+			cout << cardToString(move.discards[i]) << " ";
+		cout << "and " << (move.source == DISCARD_PILE ? "takes " + cardToString(move.take) : string("draws from the draw pile"));
+	}
+	cout << " (decided in " << ms << " ms)." << endl;
+	for (size_t i = 0; i < files.size(); i++)
+		delete files[i];
+	return 0;
 }
 
-int Yaniv::countCardInVector(vector<string> v, string c, vector<string> &discard) {
-	int count = 0, length = v.size();
-	for (int i = 0; i < length; i++) {
-		string value = getValue(v[i]);
-		if (value == c) {
-			discard.push_back(v[i]);
-			++count;
+int runBenchmarks(const SimulationOptions &options) {
+	// hands of 1-8 cards with and without jokers, each next to a real discard (often more than 1 card) to take from
+	Yaniv game;
+	SimulationOptions benchOptions = options;
+	benchOptions.players = (options.players >= MIN_PLAYERS && options.players <= MAX_PLAYERS ? options.players : 4);
+	benchOptions.searchPlayers = 0;
+	setUpGame(game, benchOptions);
+	game.rng.seed(BENCH_SEED);
+	vector <Player> hands(BENCH_STATES);
+	vector <vector <Card> > available(BENCH_STATES), attempts(BENCH_STATES);
+	for (int i = 0; i < BENCH_STATES; i++) {
+		vector <Card> deck = FULL_DECK;
+		if (i / 8 % 2) {
+			deck.erase(remove_if(deck.begin(), deck.end(), isJoker), deck.end());
+		}
+		game.shuffleCards(deck);
+		for (int j = 0; j <= i % 8; j++)
+			hands[i].addCard(deck[j]);
+		deck.erase(deck.begin(), deck.begin() + 1 + i % 8);
+		vector <vector <Card> > discards;
+		game.legalDiscards(vector <Card>(deck.begin(), deck.begin() + 6), discards);
+		available[i] = discards[game.rng.below(discards.size())];
+		for (size_t j = 0; j < discards.size() && i % 2; j++) {
+			if (discards[j].size() > 1) { available[i] = discards[j]; }
+		}
+		// half the discards tried are legal, the rest are random cards from the hand in a random order
+		game.legalDiscards(hands[i].hand, discards);
+		if (i % 2) {
+			attempts[i] = discards[game.rng.below(discards.size())];
+		}
+		else {
+			attempts[i] = hands[i].hand;
+			game.shuffleCards(attempts[i]);
+			attempts[i].resize(1 + game.rng.below(attempts[i].size()));
 		}
 	}
-	return count;
-}
 
-vector <string> Yaniv::getBestDiscard(vector<string> hand, vector<string> availableCards, bool takingFromDiscard) {
-	vector <string> discard;
-	int bestDiscardPts = pointsForCard(hand.back());
-	vector <string> bestDiscard = { hand.back() };
-	string draw = "";
-	string bestDraw = draw;
-	int numAvailableCards = availableCards.size();
-	if (availableCards.front() == "") {
-		takingFromDiscard = false;
+	vector <BenchResult> results;
+	long long availableCards = 0;
+	for (int i = 0; i < BENCH_STATES; i++)
+		availableCards += available[i].size();
+	vector <Card> best;
+	results.push_back(timeBenchmark("getBestDiscard/hand", BENCH_STATES, [&]() {
+		long long sum = 0;
+		for (int i = 0; i < BENCH_STATES; i++) {
+			game.getBestDiscard(hands[i].hand, NO_CARDS, true, best);
+			sum += best.size();
+		}
+		return sum;
+	}));
+	// the same hands sorted by value, hands of up to DISCARD_TABLE_CARDS cards are looked up in a table made here
+	DiscardTable table;
+	table.generate(game.rules.minToCallYaniv);
+	vector <vector <Card> > sortedHands(BENCH_STATES);
+	vector <Player> sortedPlayers(BENCH_STATES); // holding them through addCard keeps their points and masks up to date, as in play
+	for (int i = 0; i < BENCH_STATES; i++) {
+		sortedHands[i] = hands[i].hand;
+		game.sortCards(sortedHands[i]);
+		for (size_t j = 0; j < sortedHands[i].size(); j++)
+			sortedPlayers[i].addCard(sortedHands[i][j]);
 	}
+	game.discardTable = &table;
+	results.push_back(timeBenchmark("getBestDiscard/table", BENCH_STATES, [&]() {
+		long long sum = 0;
+		for (int i = 0; i < BENCH_STATES; i++) {
+			game.getBestDiscard(sortedHands[i], NO_CARDS, true, best);
+			sum += best.size();
+		}
+		return sum;
+	}));
+	game.discardTable = NULL;
+	results.push_back(timeBenchmark("getBestDiscard/available", BENCH_STATES, [&]() {
+		long long sum = 0;
+		for (int i = 0; i < BENCH_STATES; i++) {
+			game.getBestDiscard(hands[i].hand, available[i], true, best);
+			sum += best.size();
+		}
+		return sum;
+	}));
+	results.push_back(timeBenchmark("canDiscard", BENCH_STATES, [&]() {
+		long long sum = 0;
+		Card missingCard;
+		for (int i = 0; i < BENCH_STATES; i++)
+			sum += game.canDiscard(hands[i], attempts[i], missingCard);
+		return sum;
+	}));
+	results.push_back(timeBenchmark("canTake", availableCards, [&]() {
+		long long sum = 0;
+		bool jokerSwap;
+		for (int i = 0; i < BENCH_STATES; i++) {
+			game.availableToTake = available[i];
+			for (size_t j = 0; j < available[i].size(); j++)
+				sum += game.canTake(attempts[i], available[i][j], jokerSwap);
+		}
+		return sum;
+	}));
+	results.push_back(timeBenchmark("legalMoves", BENCH_STATES, [&]() {
+		long long sum = 0;
+		vector <Move> moves;
+		for (int i = 0; i < BENCH_STATES; i++) {
+			game.availableToTake = available[i];
+			game.legalMoves(hands[i], moves);
+			sum += moves.size();
+		}
+		return sum;
+	}));
+	// every getBestDiscard call of one AI turn, on the hands sorted the way AIs hold them
+	results.push_back(timeBenchmark("aiChooseMove", BENCH_STATES, [&]() {
+		long long sum = 0;
+		Move move;
+		for (int i = 0; i < BENCH_STATES; i++) {
+			game.availableToTake = available[i];
+			game.aiChooseMove(sortedPlayers[i], move);
+			sum += move.discards.size();
+		}
+		return sum;
+	}));
+	results.push_back(timeBenchmark("sortCards", BENCH_STATES, [&]() {
+		long long sum = 0;
+		vector <Card> cards;
+		for (int i = 0; i < BENCH_STATES; i++) {
+			cards = hands[i].hand;
+			game.sortCards(cards);
+			sum += cards.front();
+		}
+		return sum;
+	}));
+	results.push_back(timeBenchmark("countPoints", BENCH_STATES, [&]() {
+		long long sum = 0;
+		for (int i = 0; i < BENCH_STATES; i++)
+			sum += game.countPoints(hands[i].hand);
+		return sum;
+	}));
+	results.push_back(timeBenchmark("dealCards", BENCH_STATES, [&]() {
+		long long sum = 0;
+		Player player;
+		for (int i = 0; i < BENCH_STATES; i++) {
+			if (game.deck.size() < 5) { game.deck = FULL_DECK; } // refill without reshuffling the discards
+			player.clearHand();
+			game.dealCards(player, 5);
+			sum += player.hand.back();
+		}
+		return sum;
+	}));
+	results.push_back(timeBenchmark("simulateGame", BENCH_GAMES, [&]() {
+		long long sum = 0;
+		for (int i = 0; i < BENCH_GAMES; i++) {
+			game.startGame(i);
+			sum += game.simulateGame().turns;
+		}
+		return sum;
+	}));
+	results.push_back(timeBenchmark("assafRisk", BENCH_GAMES, [&]() {
+		long long sum = 0;
+		for (int i = 0; i < BENCH_GAMES; i++) {
+			game.startGame(i);
+			sum += (long long)(game.assafRisk(game.currentPlayer, game.rules.minToCallYaniv) * ASSAF_SAMPLES);
+		}
+		return sum;
+	}));
+	results.push_back(timeBenchmark("searchMove", BENCH_SEARCHES, [&]() {
+		long long sum = 0;
+		Move move;
+		for (int i = 0; i < BENCH_SEARCHES; i++) {
+			game.startGame(i);
+			Player &activePlayer = game.players[game.currentPlayer];
+			activePlayer.playouts = options.playouts;
+			activePlayer.budget = options.budget;
+			sum += game.searchMove(activePlayer, activePlayer.handPoints, move);
+			activePlayer.playouts = 0;
+			activePlayer.budget = 0;
+		}
+		return sum;
+	}));
 
-	bool ableToTakeFromMiddle = false;
-	// if the cards down are multiples of the same card
-	// and if can take any card when multiples are played
-	if (CAN_TAKE_FROM_MIDDLE_OF_SET && availableCards.front() == availableCards.back() && availableCards.front() != "J") {
-		ableToTakeFromMiddle = true;
+	// earlier results to compare with, read back from the JSON written below
+	string baseline;
+	if (options.baseline.size()) {
+		ifstream file(options.baseline.c_str());
+		if (!file) {
+			cout << "Can't read " << options.baseline << "." << endl;
+			return 1;
+		}
+		stringstream contents;
+		contents << file.rdbuf();
+		baseline = contents.str();
+	}
+	bool regressed = false;
+	for (size_t i = 0; i < results.size(); i++) {
+		cout << results[i].name << ": " << results[i].nsPerOp << " ns/op";
+		if (results[i].name == "simulateGame") {
+			cout << " (" << 1e9 / results[i].nsPerOp << " games/sec)";
+		}
+		if (results[i].name == "searchMove") {
+			cout << " (" << results[i].nsPerOp / 1e6 << " ms/decision with " << options.playouts << " playouts";
+			if (options.budget > 0) { cout << " and a " << options.budget << " ms budget"; }
+			cout << ")";
+		}
+		size_t found = baseline.find("\"name\": \"" + results[i].name + "\"");
+		if (found != string::npos) {
+			// the time has to be in the same entry, a cut short or hand-edited file could have it missing
+			size_t entryEnd = baseline.find('}', found);
+			found = baseline.find("\"ns_per_op\": ", found);
+			char *end = NULL;
+			double before = (found < entryEnd ? strtod(baseline.c_str() + found + 13, &end) : 0);
+			if (!end || end == baseline.c_str() + found + 13 || !(before > 0)) {
+				cout << endl << options.baseline << " has no time for " << results[i].name << ", it isn't a baseline written by --bench-out." << endl;
+				return 1;
+			}
+			double change = 100 * (results[i].nsPerOp / before - 1);
+			cout << ", baseline " << before << " ns/op, " << (change > 0 ? "+" : "") << change << "%";
+			if (change > options.threshold) {
+				cout << " REGRESSION";
+				regressed = true;
+			}
+		}
+		cout << endl;
 	}
 
-	int j = 0;
+	if (options.benchOut.size()) {
+		ofstream file(options.benchOut.c_str());
+		file << "{" << endl;
+		file << "  \"benchmarks\": [" << endl;
+		for (size_t i = 0; i < results.size(); i++) {
+			file << "    { \"name\": \"" << results[i].name << "\", \"ops\": " << results[i].ops << ", \"ns_per_op\": " << results[i].nsPerOp << " }" << (i + 1 < results.size() ? "," : "") << endl;
+		}
+		file << "  ]" << endl << "}" << endl;
+		if (!file) {
+			cout << "Can't write " << options.benchOut << "." << endl;
+			return 1;
+		}
+	}
+	return (regressed ? 1 : 0);
+}
 
-	// do twice if available cards
-	while (j < numAvailableCards) {
-		// if checking available cards
-		if (availableCards.front() != "") {
-			if (!ableToTakeFromMiddle && j == 1) { // if done with 0 and can't take from middle
-				j = availableCards.size() - 1; // skip to last card of available cards
+void playAiTurns(Yaniv &game, int games, function<void()> beforeTurn, function<void()> afterTurn) {
+	// AIs decide a turn at a time the way simulateGame has them decide, beforeTurn runs before each decision
+	// and afterTurn after each turn that doesn't end the round
+	for (int i = 0; i < games; i++) {
+		game.startGame(SELF_TEST_SEED + i);
+		Move move;
+		move.discards.reserve(NUM_CARDS);
+		for (int turn = 0; turn < MAX_TURNS_PER_ROUND; turn++) {
+			Player &activePlayer = game.players[game.currentPlayer];
+			if (!activePlayer.stillPlaying) {
+				game.changeTurn();
+				continue;
 			}
-			draw = availableCards[j]; // card to draw is j
-			hand.push_back(draw); // add draw to temporary hand
-			sortCards(hand);
+			beforeTurn();
+			int points = activePlayer.handPoints;
+			if (game.decideTurn(activePlayer, move)) {
+				RoundResult round;
+				int winner = game.scoreRound(activePlayer, points, round);
+				if (game.remainingPlayers == 1) { break; }
+				game.resetRound(winner);
+				continue;
+			}
+			Card drawnCard, slapdown;
+			game.aiTakeTurn(activePlayer, move, drawnCard, slapdown);
+			game.availableToTake = game.nextAvailableToTake;
+			game.changeTurn();
+			afterTurn();
 		}
+	}
+}
 
-		// check for multiples
-		const string cardValues[] = { "","A","2","3","4","5","6","7","8","9","10","J","Q","K" };
-		const int cardValuesPts[] = { 0,1,2,3,4,5,6,7,8,9,10,10,10,10 };
-		for (int k = 0; k < 14; k++) {
-			vector <string> savedCards = hand;
-			discard.clear();
-			int pointsForAllOfValue = countCardInVector(hand, cardValues[k], discard) * cardValuesPts[k];
-			if (draw == "J") { pointsForAllOfValue += 99; } // if can draw a joker, always do it
-			if (pointsForAllOfValue > bestDiscardPts) {
-				for (size_t i = 0; i < discard.size(); i++)
-					savedCards.erase(find(savedCards.begin(), savedCards.end(), discard[i]));
-				if (savedCards.size() == 0) { savedCards.push_back(""); }
-				// if taking a card, must play more than 1 card, otherwise, 1 card is fine
-				// if picking an available card, then highest card after discarding this set should not be a Joker
-				if ((discard.size() > 1 && savedCards.back() != "J") || (!takingFromDiscard)) {
-					bestDiscardPts = pointsForAllOfValue;
-					bestDiscard = discard;
-					bestDraw = draw;
-				}
+bool checkTurnAllocations(Yaniv &game) {
+	// AI turns must not touch the heap once the game is set up (rounds ending may)
+	if (!COUNTING_ALLOCATIONS) {
+		cout << "Heap allocations in AI turns: not counted (build with -DCOUNT_ALLOCATIONS)" << endl;
+		return true;
+	}
+	// the buffers AIs reuse between turns grow the first time they are needed, so the games are played once before counting
+	playAiTurns(game, SELF_TEST_GAMES, []() {}, []() {});
+	long long turns = 0, turnAllocations = 0, before = 0;
+	playAiTurns(game, SELF_TEST_GAMES, [&]() { before = allocations; }, [&]() {
+		turnAllocations += allocations - before;
+		++turns;
+	});
+	cout << "AI turns: " << turns << ", heap allocations: " << turnAllocations << endl;
+	return !turnAllocations;
+}
+
+bool checkHandTotals(Yaniv &game) {
+	// every hand's running point total must match its cards, and what each player knows must match what they've seen
+	long long turns = 0, wrongTotals = 0;
+	playAiTurns(game, SELF_TEST_GAMES, [&]() {
+		for (size_t j = 0; j < game.players.size(); j++) {
+			if (game.players[j].handPoints != game.countPoints(game.players[j].hand) || game.players[j].handSet != toCardSet(game.players[j].hand))
+				++wrongTotals;
+			// unseen cards are the ones not in the player's hand, the discard pile or drawn publicly by someone else
+			CardSet known = game.players[j].handSet | toCardSet(game.discardPile);
+			for (size_t k = 0; k < game.players.size(); k++)
+				known |= toCardSet(game.players[k].cardsDrawnPublicly);
+			const CardKnowledge &knowledge = game.players[j].knowledge;
+			if (knowledge.unseen != ((SUITED_BITS | JOKER_BITS) & ~known) || knowledge.count != countCards(knowledge.unseen) || knowledge.points != pointsInSet(knowledge.unseen))
+				++wrongTotals;
+		}
+		++turns;
+	}, []() {});
+	cout << "AI turns: " << turns << ", wrong hand totals: " << wrongTotals << endl;
+	return turns && !wrongTotals;
+}
+
+bool checkRecords(Yaniv &game) {
+	// games recorded to a file and read back must be the games that were played
+	remove(SELF_TEST_RECORD_FILE);
+	RecordWriter *writer = new RecordWriter;
+	if (!writer->open(SELF_TEST_RECORD_FILE)) {
+		cout << "Can't write " << SELF_TEST_RECORD_FILE << "." << endl;
+		delete writer;
+		return false;
+	}
+	game.recorder = writer;
+	vector <GameResult> results;
+	for (int i = 0; i < SELF_TEST_RECORD_GAMES; i++) {
+		game.startGame(SELF_TEST_SEED + i);
+		results.push_back(game.simulateGame());
+		if (i % 3 == 2) { writer->flush(); } // blocks of 3 games, so reading goes from block to block too
+	}
+	game.recorder = NULL;
+	delete writer; // writes out what is left
+	long long mismatches = 0;
+	RecordFile records;
+	size_t offset = 0;
+	GameRecordHeader header;
+	const unsigned char *events;
+	int gamesRead = 0;
+	if (!records.load(SELF_TEST_RECORD_FILE)) {
+		++mismatches;
+	}
+	while (records.nextGame(offset, header, events)) {
+		if (gamesRead >= SELF_TEST_RECORD_GAMES || !recordMatches(header, events, game.rules, game.numPlayers, results[gamesRead]))
+			++mismatches;
+		++gamesRead;
+	}
+	mismatches += abs(gamesRead - SELF_TEST_RECORD_GAMES);
+	cout << "Games recorded and read back: " << SELF_TEST_RECORD_GAMES << ", mismatches: " << mismatches << endl;
+	remove(SELF_TEST_RECORD_FILE);
+	return !mismatches;
+}
+
+bool checkReplays(Yaniv &game, const SimulationOptions &options) {
+	// replaying recorded games to every turn must rebuild the game as it was when the turn was played
+	remove(SELF_TEST_RECORD_FILE);
+	RecordWriter *writer = new RecordWriter;
+	if (!writer->open(SELF_TEST_RECORD_FILE)) {
+		cout << "Can't write " << SELF_TEST_RECORD_FILE << "." << endl;
+		delete writer;
+		return false;
+	}
+	game.recorder = writer;
+	// the games are played a turn at a time, keeping the game as it was before every decision to check replays against
+	vector <vector <Yaniv> > liveTurns(SELF_TEST_REPLAY_GAMES);
+	for (int i = 0; i < SELF_TEST_REPLAY_GAMES; i++) {
+		game.startGame(SELF_TEST_SEED + i);
+		GameResult result;
+		result.seed = game.seed;
+		int turnsInRound = 0;
+		RoundResult round;
+		while (true) {
+			game.startTurn(result, turnsInRound);
+			liveTurns[i].push_back(game);
+			if (game.simulateTurn<RuntimeRules>(result, turnsInRound)) {
+				Player &caller = game.players[game.currentPlayer];
+				int points = caller.handPoints;
+				game.scoreRound<RuntimeRules>(caller, points, round);
+				if (game.finishRound(result, round, points, turnsInRound)) { break; }
 			}
 		}
+	}
+	game.recorder = NULL;
+	delete writer; // writes out what is left
+	RecordFile records;
+	size_t offset = 0;
+	GameRecordHeader header;
+	const unsigned char *events;
+	int gamesRead = 0;
+	long long replayedTurns = 0, replayMismatches = 0;
+	if (!records.load(SELF_TEST_RECORD_FILE)) {
+		++replayMismatches;
+	}
+	Yaniv replayed;
+	setUpGame(replayed, options);
+	while (records.nextGame(offset, header, events)) {
+		for (size_t turn = 0; gamesRead < SELF_TEST_REPLAY_GAMES && turn < liveTurns[gamesRead].size(); turn++) {
+			const Yaniv &live = liveTurns[gamesRead][turn];
+			if (replayed.replay(header, events, live.turnsPlayed) < 0 || !replayed.sameState(live))
+				++replayMismatches;
+			++replayedTurns;
+		}
+		++gamesRead;
+	}
+	replayMismatches += abs(gamesRead - SELF_TEST_REPLAY_GAMES);
+	cout << "Turns replayed from records: " << replayedTurns << ", different from the game played: " << replayMismatches << endl;
+	remove(SELF_TEST_RECORD_FILE);
+	return replayedTurns && !replayMismatches;
+}
 
-		// check for series
-		int numJokers = count(hand.begin(), hand.end(), "J");
-		vector <string> savedCards;
-		for (size_t k = 0; k < hand.size(); k++) {
-			string firstCardValue;
-			char firstCardSuit;
-			int unusedJokers = numJokers;
-			int pointsForSeries = 0;
-			savedCards = hand;
-			discard.clear();
-			// Get suit and value of first card that's NOT a Joker
-			for (size_t i = k; i < hand.size(); i++) {
-				if (hand[i] != "J") {
-					firstCardValue = getValue(hand[i]);
-					firstCardSuit = getSuit(hand[i]);
-					discard.push_back(hand[i]);
-					savedCards.erase(savedCards.begin()+i);
-					pointsForSeries += pointsForCard(hand[i]);
-					k = i;
-					break;
+bool checkUndo(Yaniv &game) {
+	// taking moves back must leave the game as it was before each of them (hands in the same order too),
+	// and making them again must end the round where it ended the first time
+	long long movesTakenBack = 0, undoMismatches = 0;
+	for (int i = 0; i < SELF_TEST_UNDO_GAMES; i++) {
+		game.startGame(SELF_TEST_SEED + i);
+		vector <Yaniv> before;
+		vector <Move> made;
+		Move move;
+		while (game.remainingPlayers > 1) {
+			before.clear();
+			made.clear();
+			bool called = false;
+			for (int turn = 0; turn < MAX_TURNS_PER_ROUND && !called; turn++) {
+				while (!game.players[game.currentPlayer].stillPlaying)
+					game.changeTurn();
+				// sorting a hand to decide isn't part of a move and isn't taken back, so decide on a sorted copy
+				Player activePlayer = game.players[game.currentPlayer];
+				game.sortCards(activePlayer.hand);
+				called = game.aiDecide(activePlayer, activePlayer.handPoints, move);
+				if (!called) {
+					before.push_back(game);
+					made.push_back(move);
+					game.makeMove(move);
 				}
 			}
-			if (!discard.size()) { break; }
-			// check remaining cards if can make a series
-			for (size_t l = k + 1; l <= hand.size() + unusedJokers; l++) {
-				string nextVal = nextValue(firstCardValue);
-				string nextCard = nextVal + firstCardSuit;
-				// if hand contains next card needed in series
-				if (count(hand.begin() + k, hand.end(), nextCard)) {
-					discard.push_back(nextCard);
-					savedCards.erase(find(savedCards.begin(), savedCards.end(), nextCard));
-					pointsForSeries += pointsForCard(nextCard);
-				}
-				// if don't have the right card and can use joker (and last card was not a king)
-				else if (unusedJokers > 0 && getValue(nextCard) != "-") {
-					--unusedJokers;
-					discard.push_back("J");
-					savedCards.erase(savedCards.begin());
-					pointsForSeries += (pointsForCard(nextCard) / 2);
-				}
-				// if last card was a king, have a joker, and don't already have 3 cards to discard
-				else if (unusedJokers > 0 && getValue(nextCard) != "-" && discard.size() < 3) {
-					--unusedJokers;
-					discard.insert(discard.begin(), "J"); // put joker at front
-					savedCards.erase(savedCards.begin());
-					break;
-				}
-				else {
-					break; // can't continue series
-				}
+			Yaniv after = game;
+			for (size_t k = before.size(); k-- > 0; ) {
+				game.unmakeMove();
+				undoMismatches += !game.sameState(before[k]);
+				++movesTakenBack;
 			}
-			while (discard.back() == "J") {
-				// if saved cards are 3 or fewer points and card before leading joker is not a joker and joker is needed as 3rd card
-				// i.e. if hand is low and using only 1 joker to get rid of a couple extra cards, keep joker on end of series
-				if (countPoints(savedCards) <= MIN_TO_CALL_YANIV - 4 && discard[discard.size() - 2] != "J" && discard.size() <= 3) {
-					break;
-				}
-				discard.pop_back(); // don't end series with a joker
-				savedCards.insert(savedCards.begin(), "J");
-			}
-			if (savedCards.size() == 0) { savedCards.push_back(""); }
-			// if taking to make a series and highest card you can discard is a joker
-			if ((savedCards.back() == "J" && availableCards.front() != "" && draw != "J")) {
-				discard.clear(); // don't discard joker to make series
-			}
-			if (discard.size() >= 3) {
-				//int pointsForSeries = countPoints(discard);
-				if (draw == "J") { pointsForSeries += 99; } // if can draw a joker, always do it
-				if (pointsForSeries > bestDiscardPts) {
-					bestDiscardPts = pointsForSeries;
-					bestDiscard = discard;
-					bestDraw = draw;
-				}
+			for (size_t k = 0; k < made.size(); k++) {
+				while (!game.players[game.currentPlayer].stillPlaying)
+					game.changeTurn();
+				game.makeMove(made[k]);
+			}
+			while (!game.players[game.currentPlayer].stillPlaying)
+				game.changeTurn();
+			undoMismatches += !game.sameState(after);
+			if (called) {
+				RoundResult round;
+				Player &caller = game.players[game.currentPlayer];
+				game.resetRound(game.scoreRound(caller, caller.handPoints, round));
+			}
+			else {
+				game.resetRound(game.currentPlayer);
 			}
 		}
-
-		// if not checking available cards break after 1 pass
-		if (availableCards.front() == "") {
-			break;
-		}
-
-		// remove additional card to check with 2nd available card only
-		hand.erase(find(hand.begin(), hand.end(), draw));
-
-		++j;
 	}
+	cout << "Moves taken back: " << movesTakenBack << ", different from before the move: " << undoMismatches << endl;
+	return movesTakenBack && !undoMismatches;
+}
 
-	bestDiscard.insert(bestDiscard.begin(), bestDraw);
-	return bestDiscard;
+int runSelfTest(const SimulationOptions &options) {
+	// AIs play by the heuristic on the rules given, each check plays its own games and reports what it found
+	Yaniv game;
+	SimulationOptions testOptions = options;
+	testOptions.players = (options.players >= MIN_PLAYERS && options.players <= MAX_PLAYERS ? options.players : 4);
+	testOptions.searchPlayers = 0;
+	setUpGame(game, testOptions);
+	int failed = 0;
+	failed += !checkTurnAllocations(game);
+	failed += !checkHandTotals(game);
+	failed += !checkRecords(game);
+	failed += !checkReplays(game, testOptions);
+	failed += !checkUndo(game);
+	cout << (failed ? "Checks failed: " + to_string(failed) + "." : "All checks passed.") << endl;
+	return (failed ? 1 : 0);
 }
 
 void trim(string &str) {